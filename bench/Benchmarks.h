@@ -0,0 +1,87 @@
+#pragma once
+
+#include "AllocCounter.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One row of benchmark output. entities is the problem size, the time is the
+// best average over the measured frames divided by it.
+struct BenchResult {
+  std::string suite;
+  std::string name;
+  size_t entities = 0;
+  double nsPerEntity = 0;
+  double allocationsPerFrame = 0;
+};
+
+typedef std::vector<BenchResult> BenchResults;
+
+// Times fn() until at least minimumSeconds have passed, repeats that a few
+// times and returns the best average nanoseconds per call.
+template <typename F>
+double timeNanoseconds(F &&fn, double minimumSeconds = 0.05) {
+  using Clock = std::chrono::steady_clock;
+  double best = 0;
+  for (int round = 0; round < 5; ++round) {
+    size_t calls = 0;
+    auto start = Clock::now();
+    double elapsed = 0;
+    do {
+      fn();
+      calls++;
+      elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minimumSeconds);
+    double perCall = elapsed * 1e9 / calls;
+    if (round == 0 || perCall < best) {
+      best = perCall;
+    }
+  }
+  return best;
+}
+
+// For benchmarks whose frames change the state they run on: calls setup()
+// untimed before every frame and times only frame(). Returns the best
+// average nanoseconds per frame over a few rounds and stores the average
+// number of allocations frame() made.
+template <typename S, typename F>
+double timeFrames(int frames, S &&setup, F &&frame,
+                  double *allocationsPerFrame = nullptr) {
+  using Clock = std::chrono::steady_clock;
+  double best = 0;
+  size_t allocations = 0;
+  for (int round = 0; round < 3; ++round) {
+    double elapsed = 0;
+    for (int i = 0; i < frames; ++i) {
+      setup();
+      size_t allocationsBefore = allocationCount();
+      auto start = Clock::now();
+      frame();
+      elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+      allocations += allocationCount() - allocationsBefore;
+    }
+    double perFrame = elapsed * 1e9 / frames;
+    if (round == 0 || perFrame < best) {
+      best = perFrame;
+    }
+  }
+  if (allocationsPerFrame) {
+    *allocationsPerFrame = static_cast<double>(allocations) / (3.0 * frames);
+  }
+  return best;
+}
+
+void runSimdBenchmarks(BenchResults &results);
+void runEntityBenchmarks(BenchResults &results);
+void runGameBenchmarks(BenchResults &results);
+void runParticleBenchmarks(BenchResults &results);
+void runRenderBenchmarks(BenchResults &results);
+
+// Runs the timing wheel next to a plain sorted list of the same entries,
+// from start ticks around the slot and level boundaries and with entries
+// scheduled exactly on them. Returns the number of ticks at which the two
+// released different handles, ticks is set to the number compared.
+size_t checkTimingWheel(uint64_t &ticks);
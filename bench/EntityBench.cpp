@@ -0,0 +1,73 @@
+#include "Benchmarks.h"
+#include "EntityManager.h"
+
+#include <cstdlib>
+#include <memory>
+
+// adds count entities with the components a small enemy has
+static void addEntities(EntityManager &entities, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    Entity *entity = entities.addEntity(Tag::SmallEnemy);
+    uint32_t index = entity->index();
+    entities.transforms().add(index,
+                              CTransform(Vec2(i % 1280, i % 720),
+                                         Vec2(1, 1), 0.0f));
+    entities.shapes().add(index, 16.0f, 6, sf::Color::Red, sf::Color::White,
+                          2.0f);
+    entities.collisions().add(index, 16.0f);
+    entities.addLifespan(index, 90);
+  }
+}
+
+// EntityManager::addEntity and update under steady churn, and the removal
+// of dead entities in update() at several dead ratios
+void runEntityBenchmarks(BenchResults &results) {
+  for (size_t count : {1000, 10000, 100000}) {
+    // churn: a live population of count entities where 10% die and are
+    // replaced every frame, like bullets and small enemies do in game
+    {
+      EntityManager entities;
+      addEntities(entities, count);
+      entities.update();
+      size_t turnover = count / 10;
+      size_t next = 0;
+      double allocations = 0;
+      double ns = timeFrames(
+          200, [] {},
+          [&] {
+            const EntityVec &live = entities.getEntities();
+            for (size_t i = 0; i < turnover; ++i) {
+              live[(next + i * 7) % live.size()]->destroy();
+            }
+            next += turnover;
+            addEntities(entities, turnover);
+            entities.update();
+          },
+          &allocations);
+      results.push_back({"entity", "churn", count, ns / count, allocations});
+    }
+
+    // removal: update() right after a share of the entities died
+    for (int deadPercent : {1, 10, 50, 90}) {
+      std::unique_ptr<EntityManager> entities;
+      double allocations = 0;
+      double ns = timeFrames(
+          20,
+          [&] {
+            entities.reset(new EntityManager());
+            addEntities(*entities, count);
+            entities->update();
+            srand(1);
+            for (Entity *entity : entities->getEntities()) {
+              if (rand() % 100 < deadPercent) {
+                entity->destroy();
+              }
+            }
+          },
+          [&] { entities->update(); }, &allocations);
+      results.push_back({"entity",
+                         "removeDead/" + std::to_string(deadPercent) + "%",
+                         count, ns / count, allocations});
+    }
+  }
+}
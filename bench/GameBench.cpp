@@ -0,0 +1,144 @@
+#include "Benchmarks.h"
+#include "Game.h"
+
+#include <cmath>
+
+// Drives the private systems of Game, it is a friend of the class. The
+// world grows with the entity count so the density, and with it the number
+// of hits per frame, stays the same as in the default 1280x720 game.
+class GameBench {
+public:
+  static void resize(Game &game, size_t entities) {
+    float scale = std::sqrt(entities / 100.0f);
+    game.m_worldSize = Vec2(1280 * scale, 720 * scale);
+    float maxCollisionRadius =
+        std::max({game.m_enemyConfig.CR, game.m_playerConfig.CR,
+                  game.m_bulletConfig.CR});
+    game.m_collisionGrid.reset(game.m_worldSize, 2.0f * maxCollisionRadius);
+    // room for the small enemies a frame splits off as well
+    game.reserveEntities(entities * 2);
+  }
+
+  // tops the world up to the wanted number of enemies and bullets, the small
+  // enemies split off by the last frame are dropped
+  static void populate(Game &game, size_t entities) {
+    for (Entity *smallEnemy : game.m_entities.getEntities(Tag::SmallEnemy)) {
+      smallEnemy->destroy();
+    }
+    game.m_entities.update();
+    size_t enemies = game.m_entities.getEntities(Tag::Enemy).size();
+    size_t bullets = game.m_entities.getEntities(Tag::Bullet).size();
+    for (; enemies < entities * 9 / 10; ++enemies) {
+      game.spawnEnemy();
+    }
+    for (; bullets < entities / 10; ++bullets) {
+      Entity *bullet = game.m_entities.addEntity(Tag::Bullet);
+      Vec2 pos(game.nextRandom() % static_cast<int>(game.m_worldSize.x),
+               game.nextRandom() % static_cast<int>(game.m_worldSize.y));
+      game.m_entities.transforms().add(bullet->index(),
+                                       CTransform(pos, Vec2(5, 0), 0.0f));
+      game.m_entities.collisions().add(bullet->index(),
+                                       game.m_bulletConfig.CR);
+      game.m_entities.addLifespan(bullet->index(), 1 << 30);
+      game.m_entities.shapes().add(bullet->index(), 10.0f, 8,
+                                   sf::Color::White, sf::Color::Red, 2.0f);
+    }
+    game.m_entities.update();
+  }
+
+  static void collision(Game &game) { game.sCollision(); }
+  static void movement(Game &game) { game.sMovement(); }
+  static void update(Game &game) { game.m_entities.update(); }
+  static void save(Game &game, std::vector<char> &data) {
+    game.saveState(data);
+  }
+  static void load(Game &game, const std::vector<char> &data) {
+    game.loadState(data);
+  }
+  static void buildFrame(Game &game, RenderFrame &frame) {
+    game.buildFrame(frame, 0.5f, 1.0f);
+  }
+};
+
+// Game::sCollision, Game::sMovement and the snapshots on a headless game
+void runGameBenchmarks(BenchResults &results) {
+  for (size_t count : {1000, 10000, 100000}) {
+    Game game("../src/config.txt", true);
+    game.setSeed(1);
+    GameBench::resize(game, count);
+    GameBench::populate(game, count);
+
+    // collisions destroy and spawn entities, the world is refilled and the
+    // dead are removed outside of the measured part
+    double allocations = 0;
+    double ns = timeFrames(
+        50,
+        [&] {
+          GameBench::update(game);
+          GameBench::populate(game, count);
+        },
+        [&] { GameBench::collision(game); }, &allocations);
+    results.push_back({"game", "sCollision", count, ns / count, allocations});
+
+    ns = timeFrames(
+        50, [] {}, [&] { GameBench::movement(game); }, &allocations);
+    results.push_back({"game", "sMovement", count, ns / count, allocations});
+
+    std::vector<char> snapshot;
+    ns = timeFrames(
+        50, [] {}, [&] { GameBench::save(game, snapshot); }, &allocations);
+    results.push_back({"game", "saveState", count, ns / count, allocations});
+
+    ns = timeFrames(
+        50, [] {}, [&] { GameBench::load(game, snapshot); }, &allocations);
+    results.push_back({"game", "loadState", count, ns / count, allocations});
+
+    // one tick of movement between the frames, as in the game
+    RewindBuffer rewind;
+    rewind.reset(60);
+    ns = timeFrames(
+        50,
+        [&] {
+          GameBench::movement(game);
+          GameBench::save(game, snapshot);
+        },
+        [&] { rewind.push(0, snapshot); }, &allocations);
+    results.push_back(
+        {"game", "RewindBuffer::push", count, ns / count, allocations});
+  }
+}
+
+// The CPU side of a frame without a window: Game::buildFrame copying the
+// world out, then every shape of that frame batched into vertices at full
+// detail as drawFrame does with everything in view.
+void runRenderBenchmarks(BenchResults &results) {
+  for (size_t count : {1000, 10000, 100000}) {
+    Game game("../src/config.txt", true);
+    game.setSeed(1);
+    GameBench::resize(game, count);
+    GameBench::populate(game, count);
+
+    RenderFrame frame;
+    frame.shapes.reserve(count * 2);
+    double allocations = 0;
+    double ns = timeFrames(
+        50, [] {}, [&] { GameBench::buildFrame(game, frame); },
+        &allocations);
+    results.push_back(
+        {"render", "buildFrame", count, ns / count, allocations});
+
+    // the first frame fills the polygon cache and grows the vertex array,
+    // it is left out as in the game
+    ShapeBatch batch;
+    auto batchFrame = [&] {
+      batch.clear();
+      for (const RenderShape &entry : frame.shapes) {
+        batch.add(entry.shape, entry.position, entry.angle);
+      }
+    };
+    batchFrame();
+    ns = timeFrames(50, [] {}, batchFrame, &allocations);
+    results.push_back(
+        {"render", "ShapeBatch::add", count, ns / count, allocations});
+  }
+}
@@ -0,0 +1,61 @@
+#include "Benchmarks.h"
+#include "SimdKernels.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Compares the movement and collision kernels for every instruction set the
+// CPU supports. The scalar rows are the loops sMovement and sCollision used
+// before the kernels existed.
+void runSimdBenchmarks(BenchResults &results) {
+  const Simd::Isa isas[] = {Simd::Isa::Scalar, Simd::Isa::Sse2,
+                            Simd::Isa::Avx2};
+  const Vec2 lower(32, 32);
+  const Vec2 upper(1248, 688);
+
+  for (size_t count : {1000, 10000, 100000, 1000000}) {
+    std::vector<Vec2> positions(count);
+    std::vector<Vec2> velocities(count);
+    std::vector<float> radii(count);
+    std::vector<uint32_t> hits(count);
+    std::vector<float> times(count);
+    srand(1);
+    for (size_t i = 0; i < count; ++i) {
+      positions[i] = Vec2(rand() % 1280, rand() % 720);
+      velocities[i] =
+          Vec2(rand() % 2 ? 1.0f : -1.0f, rand() % 2 ? 1.0f : -1.0f);
+      radii[i] = 32;
+    }
+
+    for (Simd::Isa isa : isas) {
+      if (static_cast<int>(isa) > static_cast<int>(Simd::detectIsa())) {
+        continue;
+      }
+      Simd::useIsa(isa);
+      std::string suffix = std::string("/") + Simd::isaName(isa);
+      double integrate = timeNanoseconds([&] {
+        Simd::integrate(positions.data(), velocities.data(), count);
+      });
+      double bounce = timeNanoseconds([&] {
+        Simd::bounce(positions.data(), velocities.data(), count, lower, upper);
+      });
+      double overlaps = timeNanoseconds([&] {
+        Simd::overlaps(positions.data(), radii.data(), count, Vec2(640, 360),
+                       10, hits.data());
+      });
+      results.push_back({"simd", "integrate" + suffix, count,
+                         integrate / count, 0});
+      results.push_back({"simd", "bounce" + suffix, count, bounce / count, 0});
+      double sweep = timeNanoseconds([&] {
+        Simd::sweep(positions.data(), velocities.data(), radii.data(), count,
+                    Vec2(600, 360), Vec2(80, 0), 10, hits.data(),
+                    times.data());
+      });
+      results.push_back({"simd", "overlaps" + suffix, count,
+                         overlaps / count, 0});
+      results.push_back({"simd", "sweep" + suffix, count, sweep / count, 0});
+    }
+  }
+  Simd::useIsa(Simd::detectIsa());
+}
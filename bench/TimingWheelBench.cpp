@@ -0,0 +1,93 @@
+#include "Benchmarks.h"
+#include "TimingWheel.h"
+
+#include <algorithm>
+#include <map>
+
+size_t checkTimingWheel(uint64_t &ticks) {
+  // just before and on the starts of level 1, 2 and 3 slots
+  static const uint32_t starts[] = {0,     1,     255,      256,     65280,
+                                    65535, 65536, 16711680, 16777215};
+  TimingWheel wheel;
+  std::multimap<uint32_t, uint32_t> expected; // tick to handle index
+  std::vector<EntityHandle> due;
+  std::vector<uint32_t> released;
+  std::vector<uint32_t> wanted;
+  uint32_t random = 1;
+  auto nextRandom = [&random]() {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    return random;
+  };
+  uint32_t index = 0;
+  auto schedule = [&](uint32_t tick) {
+    EntityHandle handle;
+    handle.index = index++;
+    wheel.schedule(handle, tick);
+    expected.emplace(std::max(tick, wheel.now() + 1), handle.index);
+  };
+
+  size_t mismatches = 0;
+  ticks = 0;
+  for (uint32_t start : starts) {
+    wheel.clear(start);
+    expected.clear();
+    // the next slot start of each level in reach, the ticks around it and
+    // the one after, and ticks that are not in the future
+    for (int bits = 8; bits <= 24; bits += 8) {
+      uint32_t boundary = ((start >> bits) + 1) << bits;
+      if (boundary - start > (1u << 17)) {
+        continue;
+      }
+      for (uint32_t tick : {boundary - 1, boundary, boundary + 1,
+                            boundary + (1u << bits)}) {
+        schedule(tick);
+      }
+    }
+    schedule(start);
+    schedule(start > 0 ? start - 1 : 0);
+
+    uint32_t end = start + (1u << 17);
+    while (!expected.empty() || wheel.now() < end) {
+      // while turning, mostly entries a few slots out, some several levels
+      // out and some exactly on the next slot start of level 1 or 2
+      for (uint32_t n = nextRandom() % 3; n > 0 && wheel.now() < end; --n) {
+        uint32_t r = nextRandom();
+        uint32_t now = wheel.now();
+        if (r % 8 == 0) {
+          int bits = r % 16 == 0 ? 16 : 8;
+          schedule(((now >> bits) + 1) << bits);
+        } else if (r % 4 == 0) {
+          schedule(now + nextRandom() % 200000);
+        } else {
+          schedule(now + nextRandom() % 300);
+        }
+      }
+
+      due.clear();
+      wheel.advance(due);
+      ticks++;
+      released.clear();
+      for (const EntityHandle &handle : due) {
+        released.push_back(handle.index);
+      }
+      wanted.clear();
+      auto range = expected.equal_range(wheel.now());
+      for (auto it = range.first; it != range.second; ++it) {
+        wanted.push_back(it->second);
+      }
+      expected.erase(range.first, range.second);
+      std::sort(released.begin(), released.end());
+      std::sort(wanted.begin(), wanted.end());
+      if (released != wanted) {
+        mismatches++;
+      }
+    }
+    // nothing may be left behind in a slot the wheel has passed
+    if (wheel.size() != 0) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
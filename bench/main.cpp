@@ -0,0 +1,87 @@
+#include "Benchmarks.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// usage: ShapeBreakerBench [--format table|csv|json] [--suite NAME]
+//        ShapeBreakerBench --check-wheel
+int main(int argc, char *argv[]) {
+  std::string format = "table";
+  std::string suite;
+  bool checkWheel = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      format = argv[++i];
+    } else if (std::strcmp(argv[i], "--suite") == 0 && i + 1 < argc) {
+      suite = argv[++i];
+    } else if (std::strcmp(argv[i], "--check-wheel") == 0) {
+      checkWheel = true;
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--format table|csv|json]"
+                << " [--suite simd|entity|game|particles|render]"
+                << " [--check-wheel]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  // the timing wheel against a plain list, around its level boundaries
+  if (checkWheel) {
+    uint64_t ticks = 0;
+    size_t mismatches = checkTimingWheel(ticks);
+    if (mismatches > 0) {
+      std::cout << "timing wheel check: failed, " << mismatches << " of "
+                << ticks << " ticks differed" << std::endl;
+      return 1;
+    }
+    std::cout << "timing wheel check: passed (" << ticks << " ticks)"
+              << std::endl;
+    return 0;
+  }
+
+  BenchResults results;
+  if (suite.empty() || suite == "simd") {
+    runSimdBenchmarks(results);
+  }
+  if (suite.empty() || suite == "entity") {
+    runEntityBenchmarks(results);
+  }
+  if (suite.empty() || suite == "game") {
+    runGameBenchmarks(results);
+  }
+  if (suite.empty() || suite == "particles") {
+    runParticleBenchmarks(results);
+  }
+  if (suite.empty() || suite == "render") {
+    runRenderBenchmarks(results);
+  }
+
+  if (format == "csv") {
+    std::printf("suite,name,entities,ns_per_entity,allocations_per_frame\n");
+    for (const BenchResult &r : results) {
+      std::printf("%s,%s,%zu,%.4f,%.2f\n", r.suite.c_str(), r.name.c_str(),
+                  r.entities, r.nsPerEntity, r.allocationsPerFrame);
+    }
+  } else if (format == "json") {
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const BenchResult &r = results[i];
+      std::printf("  {\"suite\": \"%s\", \"name\": \"%s\", "
+                  "\"entities\": %zu, \"ns_per_entity\": %.4f, "
+                  "\"allocations_per_frame\": %.2f}%s\n",
+                  r.suite.c_str(), r.name.c_str(), r.entities, r.nsPerEntity,
+                  r.allocationsPerFrame, i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+  } else {
+    std::printf("%-8s %-20s %10s %12s %12s\n", "suite", "name", "entities",
+                "ns/entity", "allocs/frame");
+    for (const BenchResult &r : results) {
+      std::printf("%-8s %-20s %10zu %12.3f %12.2f\n", r.suite.c_str(),
+                  r.name.c_str(), r.entities, r.nsPerEntity,
+                  r.allocationsPerFrame);
+    }
+  }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// number of global operator new calls since the program started, counted by
+// the replacement allocation functions in AllocCounter.cpp. The difference
+// between two calls is how many allocations happened in between.
+size_t allocationCount();
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Entity.h"
+#include <cstdint>
+
+// A contact found by the detection phase of Game::sCollision. Detection only
+// reads the world and writes these; the response phase applies them one by
+// one in a fixed order, skipping those whose entities died earlier in it.
+struct CollisionEvent {
+  enum Kind : uint8_t { None, BulletEnemy, BulletSmallEnemy, PlayerEnemy };
+
+  EntityHandle first;  // the bullet or the player
+  EntityHandle second; // the enemy it touched
+  float time = 0;      // fraction of the tick at which they touched
+  uint32_t order = 0;  // breaks ties in time, the bullet's position
+  Kind kind = None;
+};
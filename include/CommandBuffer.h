@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Components.h"
+#include "Entity.h"
+#include "Tags.h"
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+// Records entity changes on a worker thread for EntityManager::update() to
+// apply on the main thread. Each thread owns one buffer, so recording takes
+// no locks. update() applies the commands of all buffers sorted by
+// (order key, thread, sequence). The key is whatever the caller sets with
+// setOrderKey, usually the index of the item a parallel loop is working on,
+// so the result does not depend on which thread took which chunk.
+class CommandBuffer {
+public:
+  // an entity recorded by create(), valid for components until the buffers
+  // are applied
+  struct Pending {
+    uint32_t command = UINT32_MAX;
+  };
+
+  struct TransformData {
+    CTransform transform;
+    bool bounded;
+  };
+
+  typedef std::variant<std::monostate, TransformData, CShape, CCollision,
+                       CLifespan, CInput, CScore>
+      Component;
+
+  struct Command {
+    enum Type : uint8_t { Create, Destroy, AddComponent };
+
+    Type type;
+    TagId tag;             // Create
+    uint64_t key;          // order key when recorded
+    uint32_t sequence;     // position in this buffer
+    Pending pending;       // target recorded by create() in this buffer...
+    EntityHandle entity;   // ...or an existing entity
+    Component component;   // AddComponent
+  };
+
+  void setOrderKey(uint64_t key);
+
+  Pending create(TagId tag);
+  void destroy(EntityHandle entity);
+
+  // components for an entity from create(), they take the order key of the
+  // create so they are always applied after it
+  void addTransform(Pending entity, const CTransform &transform,
+                    bool bounded = false);
+  template <typename T> void add(Pending entity, const T &component) {
+    Command command = makeCommand(Command::AddComponent);
+    command.key = m_commands[entity.command].key;
+    command.pending = entity;
+    command.component = component;
+    m_commands.push_back(command);
+  }
+
+  // components for an entity that already exists
+  template <typename T> void add(EntityHandle entity, const T &component) {
+    Command command = makeCommand(Command::AddComponent);
+    command.entity = entity;
+    command.component = component;
+    m_commands.push_back(command);
+  }
+
+  const std::vector<Command> &commands() const;
+  size_t created() const; // entities recorded by create()
+  bool empty() const;
+  void clear();    // keeps the capacity
+  void reserve(size_t commands);
+
+private:
+  std::vector<Command> m_commands;
+  uint64_t m_key = 0;
+  size_t m_created = 0;
+
+  Command makeCommand(Command::Type type) const;
+};
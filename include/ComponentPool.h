@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Components.h"
+#include "Snapshot.h"
+#include "Vec2.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Sparse set keyed by entity index. m_sparse maps an entity index to its slot
+// in the dense arrays and m_dense maps a slot back to the entity index, so
+// components stay packed and removal is a swap with the last slot.
+class SparseSet {
+public:
+  static constexpr uint32_t npos = UINT32_MAX;
+
+  bool has(uint32_t entity) const;
+  uint32_t indexOf(uint32_t entity) const;
+  size_t size() const;
+  const std::vector<uint32_t> &entities() const; // dense slot -> entity index
+  void reserve(size_t entities); // room for entity indices below entities
+
+  void save(SnapshotWriter &writer) const;
+  bool load(SnapshotReader &reader);
+  // whether every entity is below entityCount and m_sparse and m_dense point
+  // at each other, as they do unless a loaded snapshot was corrupt
+  bool consistent(size_t entityCount) const;
+
+protected:
+  std::vector<uint32_t> m_sparse;
+  std::vector<uint32_t> m_dense;
+
+  uint32_t insertEntity(uint32_t entity); // returns the new dense slot
+  // removes the entity by moving the last entity into its slot, returns the
+  // slot the derived pool has to fill from the back of its arrays
+  uint32_t eraseEntity(uint32_t entity);
+  void swapSlots(uint32_t a, uint32_t b);
+};
+
+// Packed array of one component type
+template <typename T> class ComponentPool : public SparseSet {
+  std::vector<T> m_data;
+
+public:
+  template <typename... Args> T &add(uint32_t entity, Args &&...args) {
+    if (has(entity)) {
+      return m_data[indexOf(entity)] = T(std::forward<Args>(args)...);
+    }
+    insertEntity(entity);
+    m_data.emplace_back(std::forward<Args>(args)...);
+    return m_data.back();
+  }
+
+  void remove(uint32_t entity) {
+    if (!has(entity)) {
+      return;
+    }
+    uint32_t slot = eraseEntity(entity);
+    if (slot != m_data.size() - 1) {
+      m_data[slot] = std::move(m_data.back());
+    }
+    m_data.pop_back();
+  }
+
+  void reserve(size_t entities) {
+    SparseSet::reserve(entities);
+    m_data.reserve(entities);
+  }
+
+  void save(SnapshotWriter &writer) const {
+    SparseSet::save(writer);
+    writer.writeArray(m_data);
+  }
+  bool load(SnapshotReader &reader) {
+    return SparseSet::load(reader) && reader.readArray(m_data) &&
+           m_data.size() == size();
+  }
+
+  T &get(uint32_t entity) { return m_data[indexOf(entity)]; }
+  const T &get(uint32_t entity) const { return m_data[indexOf(entity)]; }
+
+  std::vector<T> &data() { return m_data; }
+  const std::vector<T> &data() const { return m_data; }
+};
+
+// Transforms split into one array per field so the movement system streams
+// through contiguous positions and velocities. previousPositions holds the
+// positions before the last simulation tick, rendering interpolates between
+// the two. Entities added as bounded
+// (the ones that bounce off the world edges) are kept in the first
+// boundedCount() slots so the bounce kernel runs over one contiguous range.
+class TransformPool : public SparseSet {
+  size_t m_boundedCount = 0;
+
+  void swapTransforms(uint32_t a, uint32_t b);
+
+public:
+  // references into the arrays for one entity, valid until the pool changes
+  struct Ref {
+    Vec2 &pos;
+    Vec2 &velocity;
+    float &angle;
+  };
+
+  std::vector<Vec2> positions;
+  std::vector<Vec2> previousPositions;
+  std::vector<Vec2> velocities;
+  std::vector<float> angles;
+
+  Ref add(uint32_t entity, const CTransform &transform, bool bounded = false);
+  void remove(uint32_t entity);
+  Ref get(uint32_t entity);
+  size_t boundedCount() const;
+  void reserve(size_t entities);
+
+  void save(SnapshotWriter &writer) const;
+  bool load(SnapshotReader &reader);
+};
@@ -13,37 +13,50 @@ public:
       : pos(p), velocity(v), angle(a) {}
 };
 
+// regular polygon centred on the entity position, drawn by ShapeBatch
 class CShape {
 public:
-  sf::CircleShape circle;
+  float radius = 0;
+  int points = 0;
+  sf::Color fill;
+  sf::Color outline;
+  float thickness = 0;
 
+  CShape() {}
   CShape(float radius, int points, const sf::Color &fill,
          const sf::Color &outline, float thickness)
-      : circle(radius, points) {
-    circle.setFillColor(fill);
-    circle.setOutlineColor(outline);
-    circle.setOutlineThickness(thickness);
-    circle.setOrigin(radius, radius);
-  }
+      : radius(radius), points(points), fill(fill), outline(outline),
+        thickness(thickness) {}
 };
 
 class CCollision {
 public:
   float radius = 0;
+  CCollision() {}
   CCollision(float r) : radius(r) {}
 };
 
 class CScore {
 public:
   int score = 0;
+  CScore() {}
   CScore(int s) : score(s) {}
 };
 
+// The entity dies total lifespan ticks after start. Nothing counts down per
+// tick: EntityManager schedules the death when the component is added and
+// what is left is worked out from the lifespan tick when it is needed.
 class CLifespan {
 public:
-  int remaining = 0; // amount of lifespan remaining on the entity
-  int total = 0;     // the total initial amount of lifespan
-  CLifespan(int total) : remaining(total), total(total) {}
+  int total = 0;      // the total initial amount of lifespan
+  uint32_t start = 0; // lifespan tick of its first tick, set when added
+  CLifespan() {}
+  CLifespan(int total) : total(total) {}
+
+  // amount of lifespan remaining at lifespan tick now
+  int remaining(uint32_t now) const {
+    return now < start ? total : total - static_cast<int>(now - start);
+  }
 };
 
 class CInput {
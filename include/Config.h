@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+
+struct PlayerConfig {
+  int SR, CR, FR, FG, FB, OR, OG, OB, OT, V;
+  float S;
+};
+struct EnemyConfig {
+  int SR, CR, OR, OG, OB, OT, VMIN, VMAX, L, SI;
+  float SMIN, SMAX;
+};
+struct BulletConfig {
+  int SR, CR, FR, FG, FB, OR, OG, OB, OT, V, L;
+  float S;
+};
+// wave n spawns K * F^n + G * n enemies, every I ticks, while fewer than C
+// entities are alive; K = 0 keeps the single enemy spawner
+struct WaveConfig {
+  int K, I, G, C;
+  float F;
+};
+
+// Everything config.txt can set. The struct is trivially copyable (the font
+// path is a fixed array) so a compiled config is just its bytes, and a
+// reloaded config is handed to the main thread without allocating.
+struct GameConfig {
+  int windowWidth = 0;
+  int windowHeight = 0;
+  int frameLimit = 60;
+  int fullscreen = 0;
+  int worldWidth = 0; // 0 uses the window size
+  int worldHeight = 0;
+  int threadCount = 1;
+  int minChunkSize = 4096;
+  int tickRate = 0; // 0 ticks at the frame limit
+  int maxTicksPerFrame = 5;
+  int entityCapacity = 4096;
+  int stableOrder = 0;
+  int renderThread = 1; // draw on a thread of its own
+  int lowLatency = 0;   // read input right before the frame is made
+  int particleCapacity = 200000;
+  int particlesPerKill = 48;
+  int particleLifetime = 40; // ticks
+  float particleSpeed = 4;   // pixels per tick
+  int rewindSeconds = 0;
+  float lodOutline = 4; // radius in pixels below which outlines are dropped
+  float lodPolygon = 8; // and below which polygons get lodPoints vertices
+  int lodPoints = 4;
+  char fontPath[256] = {};
+  int fontSize = 24;
+  int fontR = 255, fontG = 255, fontB = 255;
+  PlayerConfig player = {};
+  EnemyConfig enemy = {};
+  BulletConfig bullet = {};
+  WaveConfig wave = {0, 60, 0, 0, 1};
+};
+
+// where loading failed, line and field are 0 and empty when they do not apply
+struct ConfigError {
+  std::string file;
+  int line = 0;
+  std::string field;
+  std::string message;
+
+  std::string str() const; // "file:line: field: message"
+};
+
+// Parses the text format: one "Name value..." line per section, '#' starts
+// a comment. Every field is range checked and the Window, Player, Enemy and
+// Bullet lines are required.
+bool parseConfig(const std::string &text, const std::string &file,
+                 GameConfig &config, ConfigError &error);
+
+// Loads either format, a compiled config is recognised by its header and
+// mapped into memory instead of parsed.
+bool loadConfig(const std::string &path, GameConfig &config,
+                ConfigError &error);
+
+// Writes config in the compiled format. The blob is a raw copy of the
+// struct, so it only loads into a build with the same layout.
+bool compileConfig(const GameConfig &config, const std::string &path,
+                   ConfigError &error);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Config.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Watches a config file with inotify on a background thread. When the file
+// changes the thread loads and validates it there, so the main thread only
+// copies the finished GameConfig out in poll(). A config that fails to load
+// is reported on stderr and the game keeps the one it has. On systems
+// without inotify start() returns false and nothing is watched.
+class ConfigWatcher {
+  std::string m_path;
+  std::string m_fileName;
+  int m_inotify = -1;
+  std::thread m_thread;
+  std::atomic<bool> m_stopping{false};
+
+  std::mutex m_mutex;
+  GameConfig m_pending;                // guarded by m_mutex
+  std::atomic<bool> m_hasPending{false};
+
+  void watchLoop();
+  void reload();
+
+public:
+  ~ConfigWatcher();
+
+  bool start(const std::string &path);
+  void stop();
+  // copies a newly loaded config into config, false when there is none; one
+  // atomic load when nothing changed
+  bool poll(GameConfig &config);
+};
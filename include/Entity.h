@@ -1,32 +1,54 @@
 #pragma once
 
-#include "Components.h"
-#include <memory>
-#include <string>
+#include "Tags.h"
+#include <cstdint>
+
+class EntityPool;
+
+// Weak reference to an entity: the slot index plus the generation the slot
+// had when the handle was taken. A slot's generation is bumped whenever it is
+// released, so handles to dead entities are detected with one compare.
+struct EntityHandle {
+  static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+  uint32_t index = invalidIndex;
+  uint32_t generation = 0;
+
+  bool operator==(const EntityHandle &rhs) const {
+    return index == rhs.index && generation == rhs.generation;
+  }
+  bool operator!=(const EntityHandle &rhs) const { return !(*this == rhs); }
+};
 
 class Entity {
   friend class EntityManager;
+  friend class EntityPool;
 
   bool m_active = true;
   size_t m_id = 0;
-  std::string m_tag = "default";
+  uint32_t m_index = 0;      // slot in the entity and component pools
+  uint32_t m_generation = 0; // bumped every time the slot is released
+  TagId m_tag = Tag::Default;
+  EntityPool *m_pool = nullptr; // queues the entity for removal on destroy()
+  // positions in EntityManager's vectors, so removal does not search them
+  uint32_t m_allIndex = 0;
+  uint32_t m_tagIndex = 0;
 
   // constructor and destructor
-  Entity(const size_t id, const std::string &tag);
+  Entity(const size_t id, const uint32_t index, const TagId tag,
+         EntityPool *pool);
 
 public:
-  // component pointers
-  std::shared_ptr<CTransform> cTransform;
-  std::shared_ptr<CShape> cShape;
-  std::shared_ptr<CCollision> cCollision;
-  std::shared_ptr<CInput> cInput;
-  std::shared_ptr<CScore> cScore;
-  std::shared_ptr<CLifespan> cLifespan;
+  // components live in the EntityManager pools, keyed by index()
 
   // private member access functions
   bool isActive() const;
-  const std::string &tag() const;
+  TagId tag() const;
   const size_t id() const;
+  uint32_t index() const;
+  EntityHandle handle() const;
+  // marks the entity dead and queues it for EntityManager::update, safe to
+  // call from parallel system loops as long as each entity is destroyed by
+  // one thread
   void destroy();
-  void updateLifeSpanAndColor();
 };
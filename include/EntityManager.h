@@ -1,28 +1,158 @@
 #pragma once
 
+#include "CommandBuffer.h"
+#include "ComponentPool.h"
 #include "Entity.h"
-#include <memory>
+#include "EntityPool.h"
+#include "Tags.h"
+#include "TimingWheel.h"
+#include <string>
 #include <vector>
-#include <map>
 
-typedef std::vector<std::shared_ptr<Entity>> EntityVec;
-typedef std::map<std::string, EntityVec> EntityMap;
+typedef std::vector<Entity *> EntityVec;
+typedef std::vector<EntityVec> EntityMap; // indexed by TagId
 
 class EntityManager {
+  TagRegistry m_tags;
   EntityVec m_entities;
   EntityVec m_entitiesToAdd;
   EntityMap m_entityMap;
   size_t    m_totalEntities = 0;
+  bool      m_stableOrder = false;
+  std::vector<uint32_t> m_firstDead; // per tag, scratch for stable removal
+  size_t    m_reserved = 0;
+  size_t    m_limit = 0; // of live and pending entities, 0 for none
 
-  void removeDeadEntities(EntityVec & vec);
+  // one per thread, applied in a fixed order at the start of update()
+  std::vector<CommandBuffer> m_commandBuffers;
+  struct CommandRef {
+    uint64_t key;
+    uint32_t thread;
+    uint32_t sequence;
+    uint32_t slot; // in m_commandEntities
+  };
+  std::vector<CommandRef> m_commandOrder; // scratch for the merge
+  std::vector<Entity *> m_commandEntities; // created entity of each command
+  std::vector<uint32_t> m_indices; // scratch for snapshots
+
+  // owns every entity, slots of dead entities are reused so the component
+  // pools stay as small as the live population
+  EntityPool m_pool;
+
+  // component pools, owned here and kept packed as entities die
+  TransformPool              m_transforms;
+  ComponentPool<CShape>      m_shapes;
+  ComponentPool<CCollision>  m_collisions;
+  ComponentPool<CInput>      m_inputs;
+  ComponentPool<CScore>      m_scores;
+  ComponentPool<CLifespan>   m_lifespans;
+
+  // deaths of the entities with a lifespan, keyed by lifespan tick
+  TimingWheel               m_expiries;
+  std::vector<EntityHandle> m_expired; // scratch for expireLifespans
+
+  // components every entity of a tag has, per tag, checked on loading
+  std::vector<uint8_t> m_requiredComponents;
+
+  // a snapshot being loaded, decoded and checked here before it replaces
+  // the live state; swapped with it, so both keep their capacity
+  struct Loading {
+    uint64_t totalEntities = 0;
+    uint32_t lifespanTick = 0;
+    std::vector<uint32_t> entities;             // slot indices
+    std::vector<std::vector<uint32_t>> tagged;  // per tag
+    TransformPool              transforms;
+    ComponentPool<CShape>      shapes;
+    ComponentPool<CCollision>  collisions;
+    ComponentPool<CInput>      inputs;
+    ComponentPool<CScore>      scores;
+    ComponentPool<CLifespan>   lifespans;
+  } m_loading;
+
+  void applyCommands();
+  void applyCommand(const CommandBuffer::Command & command, Entity * target);
+  void removeDeadEntities(Entity ** dying, size_t count);
+  void startLifespan(Entity & entity, const CLifespan & lifespan);
+  void releaseEntity(Entity & entity);
+  bool checkLoading() const;
 
  public:
   EntityManager();
 
   void update();
+  // sizes the pools and vectors for count live entities, so frames below
+  // that population do not allocate
+  void reserve(size_t count);
+
+  // Dead entities are swapped with the last entity of each vector by
+  // default, which reorders the survivors. With stable order they keep
+  // their relative order (and with it the draw order), for the cost of
+  // moving every entity behind the first dead one.
+  void setStableOrder(bool stable);
 
-  std::shared_ptr<Entity> addEntity(const std::string & tag);
+  // Systems running on the thread pool record creations, destructions and
+  // new components in the buffer of their thread instead of touching the
+  // pools. Entity::destroy() stays fine when each entity is destroyed by one
+  // thread, anything that may race goes through CommandBuffer::destroy.
+  void setThreadCount(size_t count);
+  CommandBuffer & commands(size_t thread);
+
+  // bits of requireComponents
+  enum Component : uint8_t {
+    Transform = 1,
+    Shape = 2,
+    Collision = 4,
+    Input = 8,
+    Score = 16,
+    Lifespan = 32
+  };
+  // every entity of tag has these components, a snapshot without them is
+  // not loaded
+  void requireComponents(TagId tag, uint8_t components);
+
+  // Every entity, component and vector order. Save right after update(),
+  // when no entity, death or command is pending.
+  void save(SnapshotWriter & writer);
+  // Loading is two steps so a bad snapshot changes nothing: prepareLoad
+  // decodes it and checks that it agrees with itself, the caller checks the
+  // handles it keeps with loadedEntity, and finishLoad replaces the live
+  // state with it, dropping anything pending. prepareLoad returns false on
+  // a truncated or corrupt snapshot or one of a different layout.
+  bool prepareLoad(SnapshotReader & reader);
+  bool loadedEntity(EntityHandle handle, TagId tag) const; // live in it
+  void finishLoad();
+
+  // Lifespans are added here, not on the pool, so their death is scheduled.
+  // The lifespan clock moves one tick per expireLifespans(), which destroys
+  // the entities whose lifespan ran out at that tick.
+  void addLifespan(uint32_t entity, int total);
+  void expireLifespans();
+  uint32_t lifespanTick() const;
+
+  // Live entities plus the ones waiting for the next update(), added or
+  // recorded in a command buffer, are kept at or below the limit by the
+  // callers: room() is how many more they may add. 0 is no limit. Only
+  // exact on the main thread while no system runs on the pool.
+  void setLimit(size_t limit);
+  size_t room() const; // SIZE_MAX without a limit
+
+  Entity * addEntity(TagId tag);
+  Entity * addEntity(const std::string & tag);
 
   const EntityVec & getEntities();
+  const EntityVec & getEntities(TagId tag);
   const EntityVec & getEntities(const std::string & tag);
+  Entity & getEntity(uint32_t index);
+  Entity * getEntity(EntityHandle handle); // nullptr if the handle is stale
+
+  // string side of the tags, for config and debug output
+  TagId tagId(const std::string & name);
+  const std::string & tagName(TagId tag) const;
+
+  TransformPool &             transforms() { return m_transforms; }
+  ComponentPool<CShape> &     shapes() { return m_shapes; }
+  ComponentPool<CCollision> & collisions() { return m_collisions; }
+  ComponentPool<CInput> &     inputs() { return m_inputs; }
+  ComponentPool<CScore> &     scores() { return m_scores; }
+  ComponentPool<CLifespan> &  lifespans() { return m_lifespans; }
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Entity.h"
+#include "Snapshot.h"
+#include <atomic>
+#include <deque>
+#include <vector>
+
+// Slot allocator for entities. Slots live in a deque so their addresses stay
+// stable while the pool grows, and released slots are reused before new ones
+// are appended. Destroyed entities are queued in m_dying until the
+// EntityManager removes them; the queue has room for every slot, so worker
+// threads append to it with one atomic increment.
+class EntityPool {
+public:
+  // what a snapshot keeps of an Entity, the pool pointer is this pool
+  struct SlotState {
+    uint64_t id;
+    uint32_t generation;
+    uint32_t allIndex;
+    uint32_t tagIndex;
+    TagId tag;
+    uint8_t active;
+  };
+
+private:
+  std::deque<Entity> m_slots;
+  std::vector<uint32_t> m_freeSlots;
+  std::vector<Entity *> m_dying;
+  std::atomic<size_t> m_dyingCount{0};
+  std::vector<SlotState> m_slotStates; // scratch for snapshots
+  std::vector<uint32_t> m_loadedFreeSlots; // free list of a prepared load
+  std::vector<uint8_t> m_marks;            // scratch for checking it
+
+public:
+  Entity *create(size_t id, TagId tag);
+  // creates dead slots up to count, they are handed out in index order
+  // before the pool grows again
+  void reserve(size_t count);
+  void release(Entity &entity);
+
+  // nullptr when the handle's slot has been released since it was taken
+  Entity *get(EntityHandle handle);
+  Entity &at(uint32_t index);
+
+  size_t capacity() const;
+
+  void queueDeath(Entity &entity); // called by Entity::destroy()
+  // entities destroyed since the last clearDying(), in no particular order
+  Entity **dying();
+  size_t dyingCount() const;
+  void clearDying();
+
+  // every slot with its generation and the free list, taken when no entity
+  // is waiting to be removed
+  void save(SnapshotWriter &writer);
+  // Loading is two steps so a bad snapshot leaves the pool as it was:
+  // prepareLoad reads the slots and checks the free list without touching
+  // the pool, loadedSlots shows them, finishLoad makes them the pool's
+  // slots and clears the dying queue.
+  bool prepareLoad(SnapshotReader &reader);
+  const std::vector<SlotState> &loadedSlots() const;
+  void finishLoad();
+};
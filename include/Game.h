@@ -1,62 +1,171 @@
 #pragma once
 
+#include "CollisionEvent.h"
+#include "Config.h"
+#include "ConfigWatcher.h"
 #include "Entity.h"
 #include "EntityManager.h"
+#include "LatencyTracker.h"
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "ShapeBatch.h"
+#include "Snapshot.h"
+#include "SpatialHash.h"
+#include "ThreadPool.h"
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
-#include <memory>
-
-struct PlayerConfig {
-  int SR, CR, FR, FG, FB, OR, OG, OB, OT, V;
-  float S;
-};
-struct EnemyConfig {
-  int SR, CR, OR, OG, OB, OT, VMIN, VMAX, L, SI;
-  float SMIN, SMAX;
-};
-struct BulletConfig {
-  int SR, CR, FR, FG, FB, OR, OG, OB, OT, V, L;
-  float S;
-};
+#include <atomic>
+#include <thread>
 
 class Game {
+  friend class GameBench; // drives the systems in bench/GameBench.cpp
+
   sf::RenderWindow m_window; // the window we will draw to
+  Vec2 m_worldSize;          // simulation bounds, independent of the window
   EntityManager m_entities;  // vector of entities to maintain
   sf::Font m_font;           // the font we will use to draw
   sf::Text m_text;           // the score text to be drawn to the screen
+  ShapeBatch m_shapeBatch;   // every entity shape, drawn in one call
+  RenderStyle m_renderStyle; // from the config, copied into every frame
+  RenderStyle m_drawnStyle;  // the one the text was last set up with
+  struct RenderStats {
+    std::atomic<size_t> drawn{0};
+    std::atomic<size_t> culled{0};     // outside the view
+    std::atomic<size_t> simplified{0}; // fewer vertices or no outline
+  } m_renderStats; // of the last frame drawn, shown in the overlay
+  RenderQueue m_renderQueue;   // frames from the simulation to the renderer
+  std::thread m_renderThread;  // draws them when RenderThread is on
+  std::atomic<bool> m_renderStopping{false};
+  bool m_useRenderThread = false;
+  bool m_lowLatency = false; // Latency mode, see run()
+  int m_frameLimit = 0;      // frames per second the loop paces itself to
+  RenderQueue::Clock::time_point m_lastPoll; // of input, by sUserInput
+  // polls of the oldest input no tick has run on yet, and of the oldest one
+  // that reaches the next frame
+  RenderQueue::Clock::time_point m_inputPolled, m_inputPreviousPoll;
+  RenderQueue::Clock::time_point m_shownInputPolled, m_shownInputPreviousPoll;
+  LatencyTracker m_latency;           // input to display(), by drawFrame
+  std::vector<float> m_latencyScratch; // to take its percentiles
+  ParticleSystem m_particles; // debris of destroyed shapes, visual only
+  int m_particlesPerKill = 0;
+  float m_particleLifetime = 0;
+  float m_particleSpeed = 0;
   PlayerConfig m_playerConfig;
   EnemyConfig m_enemyConfig;
   BulletConfig m_bulletConfig;
+  WaveConfig m_waveConfig;
+  GameConfig m_startConfig; // the settings a reload cannot change
+  ConfigWatcher m_configWatcher; // reloads the config file when it changes
+  SpatialHash m_collisionGrid; // broadphase for enemies and small enemies
+  std::vector<Vec2> m_motions; // per transform slot, moved this tick
+  std::vector<Vec2> m_renderPositions; // per transform slot, interpolated
+  std::vector<Entity *> m_drawnEntities; // live ones, in draw order
+  std::vector<CollisionEvent> m_collisionEvents; // of this tick, in order
+  ThreadPool m_threadPool;     // runs the per-entity system loops
+  Profiler m_profiler;         // per-system timings of the last frames
+  sf::Text m_profilerText;     // overlay with the profiler statistics
+  std::string m_profilerString; // its text, built on the main thread
+  uint32_t m_profilerVersion = 0;      // bumped when m_profilerString changes
+  uint32_t m_shownProfilerVersion = 0; // the version m_profilerText shows
+  RenderQueue::Clock::time_point m_profilerRefreshed; // m_profilerString built
+  std::string m_tracePath = "trace.json"; // where F4 writes the trace
+  bool m_showProfiler = false;            // overlay toggled with F3
+  bool m_traceOnExit = false;             // set by enableTrace
+  int m_autofireInterval = 0;             // headless special weapon period
+  int m_allocationCheckWarmup = -1;       // frames before allocations fail
+  size_t m_frameAllocations = 0;          // heap allocations of last frame
   int m_score = 0;
-  int m_currentFrame = 0;
+  int m_shownScore = -1; // score the text currently shows
+  int m_currentFrame = 0;          // simulation ticks run so far
+  float m_tickSeconds = 1 / 60.0f; // fixed length of one simulation tick
+  int m_maxTicksPerFrame = 5;      // catch-up limit after a slow frame
   int m_lastEnemySpawnTime = 0;
+  int m_wave = 0;            // waves spawned so far
+  size_t m_waveSpawned = 0;  // enemies in the last wave
+  size_t m_entityCapacity = 0; // entities the storage is reserved for
+  uint32_t m_random = 1; // xorshift32 state, part of the snapshots
+  RewindBuffer m_rewind;       // the last ticks, stepped back while held
+  std::vector<char> m_snapshot; // scratch for saving and rewinding
+  std::string m_snapshotPath = "snapshot.bin"; // F5 saves here, F9 loads
+  bool m_rewinding = false;                    // backspace is held
   bool m_paused = false; // whether we update game logic
   bool m_running = true;
+  bool m_headless = false; // simulate without a window, input or rendering
   const int enemyScorePoints = 20;
   const int smallEnemyScorePoints = 40;
 
-  std::shared_ptr<Entity> m_player;
+  EntityHandle m_player; // handle of the current player entity
   void init(const std::string
                 &config); // initialize th GameState with a config file path
+  void applyConfig(const GameConfig &config); // the settings that can change
+                                              // while the game runs
+  void reserveEntities(size_t capacity); // grows the entity storage to it
   void setPaused(bool paused);     // pause the game
+  void simulate();                 // run one tick of game logic
   void sMovement();                // System: Entity position / movement update
   void sUserInput();               // System: User Input
   void sLifespan();                // System: Lifespan
-  void sRender();                  // System: Render / Drawing
+  // sets the alpha of shape from how much of the entity's lifespan is left
+  void fadeByLifespan(uint32_t entity, CShape &shape);
+  // System: Render / Drawing, alpha is how far the frame is into the next tick
+  // and ticks how many ticks of time passed since the last frame. Builds the
+  // frame and draws it, or hands it to the render thread.
+  void sRender(float alpha, float ticks);
+  void buildFrame(RenderFrame &frame, float alpha, float ticks);
+  void drawFrame(const RenderFrame &frame); // on the render thread if any
+  void renderLoop();                        // body of the render thread
+  void startRenderThread();
+  void stopRenderThread();
+  // blocks until the render thread will need the next frame in lead time
+  void waitForRenderSlot(RenderQueue::Clock::duration lead);
+  // blocks until the frame after the one started at lastFrame is due at the
+  // frame limit
+  void waitForFrameSlot(RenderQueue::Clock::time_point lastFrame);
+  // the input to display() percentiles, empty before the first input
+  std::string latencySummary();
   void sEnemySpawner();            // System: Spawns Enemies
+  void spawnWave();                // the next wave of the wave mode
   void sCollision();               // System: Collisions
+  void sParticles();               // System: Particle movement
+  void emitDebris(Entity *entity, float amount); // particles in the colors of
+                                                 // a destroyed entity
   void sPlayerInputStateProcess(); // System: Player input process basing on
                                    // input state
+  void updateProfilerText(); // refresh the overlay text from the profiler
+  void writeTrace();         // dump the profiler history to m_tracePath
+  Entity *player(); // the entity behind m_player
+  CommandBuffer &commands(); // deferred changes from the calling thread
+  // the whole simulation state, particles and the window excluded. A bad
+  // snapshot is not loaded, loadState returns false and changes nothing.
+  void saveState(std::vector<char> &data);
+  bool loadState(const std::vector<char> &data);
+  uint32_t nextRandom();
   void spawnPlayer();
   void spawnEnemy();
-  void spawnSmallEnemies(std::shared_ptr<Entity> entity);
-  void spawnBullet(std::shared_ptr<Entity> entity, const Vec2 &mousePos);
-  void spawnSpecialWeapon(std::shared_ptr<Entity> entity);
+  void spawnSmallEnemies(Entity *entity);
+  void spawnBullet(Entity *entity, const Vec2 &mousePos);
+  void spawnSpecialWeapon(Entity *entity);
 
 public:
-  Game(const std::string &config); // constructor, takes in game config
+  Game(const std::string &config,
+       bool headless = false); // constructor, takes in game config
+  ~Game();
   void run();
+  int runHeadless(int frames); // step N frames as fast as possible and
+                               // report frames per second and entity counts,
+                               // returns the process exit status
+  void setAutofire(int frames); // headless: fire the special weapon every N
+                                // frames
+  void checkAllocations(int warmupFrames); // headless: fail when a frame
+                                           // after the warm-up allocates
+  void setSeed(unsigned int seed); // reseed the random spawns
+  void enableTrace(const std::string &path); // profile every frame and write
+                                             // the trace to path on exit
+  uint64_t worldChecksum(); // hash of every transform, to compare two runs
+  bool saveSnapshot(const std::string &path); // write the world to a file
+  bool loadSnapshot(const std::string &path); // and read it back
   int rundomNumber(int min, int max);
   sf::Color rundomColor();
   Vec2 rundomVelocity();
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Input to display() latency of the last frames that showed new input. SFML
+// events carry no time, so each sample is a pair of bounds: from the poll
+// that read the input (the least it can have waited) and from the poll
+// before it (the most, the input arrived somewhere in between). One thread
+// records, any thread can read the percentiles.
+class LatencyTracker {
+public:
+  static constexpr size_t historySamples = 1024;
+
+private:
+  std::atomic<float> m_fromPoll[historySamples];
+  std::atomic<float> m_fromPreviousPoll[historySamples];
+  std::atomic<uint64_t> m_count{0};
+
+public:
+  LatencyTracker();
+
+  void record(float fromPollMs, float fromPreviousPollMs);
+  size_t samples() const; // in the history
+  // percentile (0 to 1) of both bounds over the history, scratch is reused
+  // between calls
+  void percentile(double p, float &fromPollMs, float &fromPreviousPollMs,
+                  std::vector<float> &scratch) const;
+};
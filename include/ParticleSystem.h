@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "Vec2.h"
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// Purely visual debris, kept apart from the EntityManager so explosions can
+// emit thousands of particles without entities, components or collisions.
+// Particles live in fixed-capacity arrays (one per field) used as a ring in
+// emission order: the live ones are the m_count slots before m_head, the
+// oldest retire from the back of the window and, when the ring is full, new
+// particles overwrite the oldest ones. Movement runs the SIMD integrate
+// kernel over the window and the whole system is drawn as one quad batch,
+// built into a vector the caller owns so it can be drawn on another thread.
+class ParticleSystem {
+  size_t m_capacity = 0;
+  size_t m_head = 0;  // slot the next particle is written to
+  size_t m_count = 0; // slots in the live window, expired ones included
+  std::vector<Vec2> m_positions;
+  std::vector<Vec2> m_velocities;
+  std::vector<float> m_ages;      // ticks lived
+  std::vector<float> m_lifetimes; // ticks to live
+  std::vector<sf::Color> m_colors;
+  uint32_t m_random = 0x9e3779b9u; // own generator, the game's rand() stays
+                                   // untouched by visual effects
+
+  float randomUnit(); // uniform in [0, 1)
+  size_t tail() const;
+
+public:
+  // allocates room for capacity particles, 0 disables the system
+  void reset(size_t capacity);
+  size_t capacity() const;
+  size_t size() const;
+
+  // count particles flying out of pos in random directions, at up to
+  // maxSpeed per tick, fading out over about lifetime ticks
+  void emit(const Vec2 &pos, size_t count, const sf::Color &color,
+            float maxSpeed, float lifetime);
+  // advances every particle by one tick
+  void update(ThreadPool &pool);
+  // fills vertices with four per particle, positions are extrapolated back
+  // by 1 - alpha of a tick to match the interpolated entities
+  void buildVertices(float alpha, float size, ThreadPool &pool,
+                     std::vector<sf::Vertex> &vertices) const;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ids of the timed zones, one per system plus the whole frame
+namespace Zone {
+enum : uint8_t {
+  Frame,
+  Update,
+  UserInput,
+  Movement,
+  Lifespan,
+  EnemySpawner,
+  Collision,
+  Particles,
+  Rewind,
+  Render,
+  Count
+};
+} // namespace Zone
+
+// Frame profiler for the main thread. Scopes add their time to a zone of the
+// current frame; the last historyFrames frames are kept in rings for the
+// rolling statistics and the Chrome trace. While disabled a Scope costs one
+// branch and records nothing.
+class Profiler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  // times its own lifetime into a zone
+  class Scope {
+    Profiler &m_profiler;
+    uint8_t m_zone;
+    bool m_active;
+    Clock::time_point m_start;
+
+  public:
+    Scope(Profiler &profiler, uint8_t zone)
+        : m_profiler(profiler), m_zone(zone), m_active(profiler.m_enabled) {
+      if (m_active) {
+        m_start = Clock::now();
+      }
+    }
+    ~Scope() {
+      if (m_active) {
+        m_profiler.record(m_zone, m_start, Clock::now());
+      }
+    }
+  };
+
+  explicit Profiler(size_t historyFrames = 240);
+
+  void setEnabled(bool enabled);
+  bool enabled() const;
+  void beginFrame();
+  void endFrame();
+  void record(uint8_t zone, Clock::time_point start, Clock::time_point end);
+
+  size_t frames() const;                 // frames in the history
+  double average(uint8_t zone) const;    // milliseconds per frame
+  double percentile(uint8_t zone, double p); // p in [0, 1], milliseconds
+  static const char *zoneName(uint8_t zone);
+
+  // writes the history as Chrome trace_event JSON, for chrome://tracing or
+  // ui.perfetto.dev. Returns false if the file could not be written.
+  bool writeTrace(const std::string &path) const;
+
+private:
+  struct Event {
+    uint8_t zone;
+    int64_t start;    // nanoseconds since m_origin
+    int64_t duration; // nanoseconds
+  };
+
+  bool m_enabled = false;
+  bool m_inFrame = false;
+  size_t m_history;
+  size_t m_cursor = 0; // ring slot of the current frame
+  size_t m_frames = 0;
+  Clock::time_point m_origin;
+  Clock::time_point m_frameStart;
+  std::vector<float> m_totals;              // ms, m_history rows of zones
+  std::vector<std::vector<Event>> m_events; // one list per ring slot
+  std::vector<float> m_scratch;             // percentile workspace
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Components.h"
+#include "Vec2.h"
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one entity as it is drawn: its interpolated position and angle and a copy
+// of its shape
+struct RenderShape {
+  Vec2 position;
+  float angle = 0;
+  CShape shape;
+};
+
+// the settings the renderer applies, they come from the config and can be
+// reloaded while the game runs
+struct RenderStyle {
+  int frameLimit = 0;
+  int fontSize = 0;
+  sf::Color fontColor;
+  float lodOutline = 0; // pixel radius below which outlines are dropped
+  float lodPolygon = 0; // and below which polygons are simplified
+  int lodPoints = 3;    // vertices of a simplified polygon
+};
+
+// Everything needed to draw one frame, copied out of the world by the main
+// thread. The renderer reads nothing else of the game, so the simulation can
+// go on while a frame is drawn.
+struct RenderFrame {
+  std::vector<RenderShape> shapes;
+  std::vector<sf::Vertex> particles; // quads
+  int score = 0;
+  bool showProfiler = false;
+  std::string profilerText;
+  uint32_t profilerVersion = 0; // changes when profilerText does
+  RenderStyle style;
+  // the poll that read the oldest input this frame is the first to show and
+  // the poll before it, the input arrived in between. Zero without new input.
+  std::chrono::steady_clock::time_point inputPolled;
+  std::chrono::steady_clock::time_point inputPreviousPoll;
+};
+
+// Lock-free triple buffer handing RenderFrames from the main thread to the
+// render thread. The main thread fills back() and publishes it; the render
+// thread takes the newest published frame. Publishing and taking are each
+// one atomic exchange of the middle buffer, neither side ever waits for the
+// other, and the buffers keep their capacity so a warmed-up handoff does not
+// allocate.
+class RenderQueue {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+private:
+  enum : uint8_t { IndexMask = 3, Fresh = 4 };
+
+  RenderFrame m_frames[3];
+  uint8_t m_back = 0;                     // main thread
+  uint8_t m_front = 2;                    // render thread
+  std::atomic<uint8_t> m_middle{1};       // index, Fresh when not yet taken
+  std::atomic<int64_t> m_takenAt{0};  // when the last frame was taken
+  std::atomic<int64_t> m_drawTime{0}; // average time from take to drawn()
+
+public:
+  // room in every buffer, so frames up to that size never allocate
+  void reserve(size_t shapes, size_t particleVertices);
+
+  // main thread: the frame to fill, then hand it over with publish()
+  RenderFrame &back();
+  void publish();
+  // whether the render thread took the last published frame
+  bool taken() const;
+  // when the render thread is expected to be ready for its next frame, from
+  // how long the last frames took to draw
+  Clock::time_point nextTake() const;
+
+  // render thread: the newest published frame, nullptr when there is none
+  // since the last take. It stays valid until the next take.
+  const RenderFrame *take();
+  // render thread: the taken frame is on screen
+  void drawn();
+
+  // waits a moment in a polling loop: spins first, then yields and sleeps
+  static void backoff(unsigned &spins);
+};
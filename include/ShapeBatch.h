@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Components.h"
+#include "Vec2.h"
+#include <SFML/Graphics.hpp>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Collects the fill and outline triangles of many CShapes into a single
+// vertex array so the whole frame is submitted with one draw call. The
+// polygon for every (vertex count, radius) pair is generated once and cached.
+class ShapeBatch {
+  struct UnitPolygon {
+    std::vector<sf::Vector2f> points; // vertices around the centre
+    std::vector<sf::Vector2f> miters; // outline offset per unit thickness
+  };
+
+  std::map<std::pair<int, float>, UnitPolygon> m_polygons;
+  std::vector<sf::Vector2f> m_scratch; // rotated inner and outer vertices
+  sf::VertexArray m_vertices{sf::Triangles};
+
+  const UnitPolygon &unitPolygon(int points, float radius);
+
+public:
+  void clear();
+  // angle is in degrees, as sf::Transformable::setRotation takes it
+  void add(const CShape &shape, const Vec2 &pos, float angle);
+  // level of detail version: the polygon gets points vertices instead of
+  // the shape's, and the outline is left out unless outlined
+  void add(const CShape &shape, const Vec2 &pos, float angle, int points,
+           bool outlined);
+  void draw(sf::RenderTarget &target) const;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Vec2.h"
+#include <cstddef>
+#include <cstdint>
+
+// Bulk kernels over contiguous Vec2 arrays (x and y interleaved). Every
+// kernel has a scalar version plus SSE2 and AVX2 versions on x86-64; the
+// widest one the CPU supports is picked once, when the program starts.
+namespace Simd {
+
+enum class Isa { Scalar, Sse2, Avx2 };
+
+Isa detectIsa();              // best instruction set this CPU runs
+Isa activeIsa();              // instruction set the kernels currently use
+void useIsa(Isa isa);         // force one, e.g. to compare them in benchmarks
+const char *isaName(Isa isa);
+
+// positions[i] += velocities[i]
+void integrate(Vec2 *positions, const Vec2 *velocities, size_t count);
+
+// keeps positions inside [min, max]: a position past an edge is clamped to it
+// and the matching velocity component is turned to point back inside
+void bounce(Vec2 *positions, Vec2 *velocities, size_t count, const Vec2 &min,
+            const Vec2 &max);
+
+// writes the index of every circle that overlaps the probe circle, i.e.
+// distSquared < (radius + probeRadius)^2, and returns how many there are.
+// hits needs room for count entries.
+size_t overlaps(const Vec2 *positions, const float *radii, size_t count,
+                const Vec2 &probe, float probeRadius, uint32_t *hits);
+
+// swept version of overlaps for one tick: circle i moved by motions[i] and
+// ended at positions[i], the probe started at probe and moved by
+// probeMotion. Writes the index of every circle the probe touched during
+// the tick and the fraction of the tick, 0 to 1, at which it first did.
+// hits and times need room for count entries.
+size_t sweep(const Vec2 *positions, const Vec2 *motions, const float *radii,
+             size_t count, const Vec2 &probe, const Vec2 &probeMotion,
+             float probeRadius, uint32_t *hits, float *times);
+
+} // namespace Simd
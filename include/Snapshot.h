@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Binary world state. A snapshot is a short header followed by the raw bytes
+// of the pools, each array stored as its element size, its length and a
+// memcpy of the elements, so saving and loading cost about as much as
+// copying the arrays. Only a build with the same component layout can load
+// it; the element sizes catch most mismatches.
+namespace Snapshot {
+const char magic[4] = {'S', 'B', 'S', 'S'};
+const uint32_t version = 3;
+} // namespace Snapshot
+
+class SnapshotWriter {
+  std::vector<char> &m_data;
+
+public:
+  // clears data, its capacity is reused
+  explicit SnapshotWriter(std::vector<char> &data);
+
+  template <typename T> void write(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "snapshots copy raw bytes");
+    writeBytes(&value, sizeof(T));
+  }
+
+  template <typename T> void writeArray(const std::vector<T> &values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "snapshots copy raw bytes");
+    write(static_cast<uint32_t>(sizeof(T)));
+    write(static_cast<uint64_t>(values.size()));
+    writeBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  // pads the snapshot to whole 8 byte words, the rewind deltas work on them
+  void finish();
+
+private:
+  void writeBytes(const void *bytes, size_t size);
+};
+
+// Reads what SnapshotWriter wrote. Every read is bounds checked, after the
+// first failure ok() is false and the rest of the reads do nothing.
+class SnapshotReader {
+  const char *m_data;
+  size_t m_size;
+  size_t m_offset = 0;
+  bool m_ok = true;
+
+  bool readBytes(void *bytes, size_t size);
+
+public:
+  SnapshotReader(const char *data, size_t size);
+
+  template <typename T> bool read(T &value) {
+    return readBytes(&value, sizeof(T));
+  }
+
+  template <typename T> bool readArray(std::vector<T> &values) {
+    uint32_t elementSize = 0;
+    uint64_t count = 0;
+    if (!read(elementSize) || !read(count)) {
+      return false;
+    }
+    if (elementSize != sizeof(T) || count > (m_size - m_offset) / sizeof(T)) {
+      m_ok = false;
+      return false;
+    }
+    values.resize(static_cast<size_t>(count));
+    return readBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  bool ok() const;
+};
+
+// The snapshots of the last frames, newest last. Only the newest is kept
+// whole, every older frame is stored as the XOR of its words with the next
+// frame, run length encoded. Consecutive frames differ in few words (moving
+// positions, counters) so the deltas are small, and XOR undoes itself, so
+// stepping back one frame decodes one delta.
+class RewindBuffer {
+  struct Frame {
+    int frame = 0;
+    size_t previousWords = 0;    // length of the frame before this one
+    std::vector<uint64_t> delta; // zero run, literal count, literals...
+  };
+
+  std::vector<Frame> m_frames; // ring of capacity entries
+  size_t m_first = 0;          // oldest entry
+  size_t m_count = 0;
+  std::vector<uint64_t> m_latest; // the newest frame, whole
+  std::vector<uint64_t> m_scratch;
+  size_t m_deltaWords = 0; // total stored, for the memory statistics
+
+public:
+  // room for the last capacity frames, 0 disables the buffer
+  void reset(size_t capacity);
+  size_t capacity() const;
+  size_t size() const;
+  size_t bytes() const; // memory held by the deltas and the newest frame
+
+  // snapshot has to be finish()ed, when the ring is full the oldest frame
+  // is dropped
+  void push(int frame, const std::vector<char> &snapshot);
+  // removes the newest frame and copies it into snapshot, false when empty
+  bool pop(int &frame, std::vector<char> &snapshot);
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "Entity.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+#include "Vec2.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid broadphase over the world rectangle. Items are staged with
+// insert() and bucketed by cell with a counting sort in build(), so the grid
+// is rebuilt every frame without per-cell allocations. Positions outside the
+// world are clamped into the border cells. The sorted positions and radii are
+// also kept in their own arrays so queryOverlaps() and querySwept() can run
+// the narrowphase with the SIMD kernels over each row of cells. Queries only
+// write the kernel scratch of the calling thread, so a built grid can be
+// queried from the thread pool.
+class SpatialHash {
+public:
+  struct Item {
+    Entity *entity = nullptr;
+    Vec2 pos;
+    float radius = 0;
+    int group = 0; // caller defined, e.g. which tag the entity belongs to
+    Vec2 motion;   // how far it moved this tick to reach pos
+  };
+
+  void reset(const Vec2 &worldSize, float cellSize);
+  void clear();
+  void insert(Entity *entity, const Vec2 &pos, float radius, int group,
+              const Vec2 &motion = Vec2());
+  void build();
+  void reserve(size_t items); // room for items without allocating
+  // one query scratch per thread of the pool running the queries
+  void setThreadCount(size_t count);
+
+  // calls visit(const Item &) for every item whose cell overlaps the circle
+  // (pos, radius) grown by the largest inserted radius
+  template <typename F>
+  void query(const Vec2 &pos, float radius, F &&visit) const {
+    if (m_items.empty()) {
+      return;
+    }
+    float reach = radius + m_maxRadius;
+    int minX = cellX(pos.x - reach);
+    int maxX = cellX(pos.x + reach);
+    int minY = cellY(pos.y - reach);
+    int maxY = cellY(pos.y + reach);
+    for (int y = minY; y <= maxY; ++y) {
+      for (int x = minX; x <= maxX; ++x) {
+        size_t cell = static_cast<size_t>(y) * m_columns + x;
+        for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i) {
+          visit(m_items[i]);
+        }
+      }
+    }
+  }
+
+  // calls visit(const Item &) for every item whose circle overlaps the circle
+  // (pos, radius), the visitor must not query the grid again
+  template <typename F>
+  void queryOverlaps(const Vec2 &pos, float radius, F &&visit) const {
+    if (m_items.empty()) {
+      return;
+    }
+    float reach = radius + m_maxRadius;
+    int minX = cellX(pos.x - reach);
+    int maxX = cellX(pos.x + reach);
+    int minY = cellY(pos.y - reach);
+    int maxY = cellY(pos.y + reach);
+    std::vector<uint32_t> &hits = m_scratch[ThreadPool::threadIndex()].hits;
+    for (int y = minY; y <= maxY; ++y) {
+      // the cells of one row are neighbours in the sorted arrays
+      size_t row = static_cast<size_t>(y) * m_columns;
+      uint32_t first = m_cellStart[row + minX];
+      uint32_t last = m_cellStart[row + maxX + 1];
+      size_t hitCount =
+          Simd::overlaps(m_positions.data() + first, m_radii.data() + first,
+                         last - first, pos, radius, hits.data());
+      for (size_t i = 0; i < hitCount; ++i) {
+        visit(m_items[first + hits[i]]);
+      }
+    }
+  }
+
+  // The circle (from, radius) moving by motion over the tick, against the
+  // items moving by theirs. Returns the item it touches first among those
+  // accept(const Item &) takes and the fraction of the tick at which it does
+  // in time, or nullptr. Ties go to the item found first.
+  template <typename F>
+  const Item *querySwept(const Vec2 &from, const Vec2 &motion, float radius,
+                         float &time, F &&accept) const {
+    const Item *first = nullptr;
+    if (m_items.empty()) {
+      return first;
+    }
+    // an item is never further than m_maxMotion from the cell of its pos
+    float reach = radius + m_maxRadius + m_maxMotion;
+    Vec2 to = from + motion;
+    int minX = cellX(std::min(from.x, to.x) - reach);
+    int maxX = cellX(std::max(from.x, to.x) + reach);
+    int minY = cellY(std::min(from.y, to.y) - reach);
+    int maxY = cellY(std::max(from.y, to.y) + reach);
+    Scratch &scratch = m_scratch[ThreadPool::threadIndex()];
+    for (int y = minY; y <= maxY; ++y) {
+      size_t row = static_cast<size_t>(y) * m_columns;
+      uint32_t begin = m_cellStart[row + minX];
+      uint32_t end = m_cellStart[row + maxX + 1];
+      size_t hitCount = Simd::sweep(
+          m_positions.data() + begin, m_motions.data() + begin,
+          m_radii.data() + begin, end - begin, from, motion, radius,
+          scratch.hits.data(), scratch.times.data());
+      for (size_t i = 0; i < hitCount; ++i) {
+        const Item &item = m_items[begin + scratch.hits[i]];
+        if ((first == nullptr || scratch.times[i] < time) && accept(item)) {
+          first = &item;
+          time = scratch.times[i];
+        }
+      }
+    }
+    return first;
+  }
+
+private:
+  // output of the kernels, sized for every item
+  struct Scratch {
+    std::vector<uint32_t> hits;
+    std::vector<float> times;
+  };
+
+  float m_cellSize = 1;
+  float m_inverseCellSize = 1;
+  int m_columns = 1;
+  int m_rows = 1;
+  float m_maxRadius = 0;
+  float m_maxMotion = 0; // largest motion component of the inserted items
+  std::vector<Item> m_pending;        // items inserted this frame
+  std::vector<Item> m_items;          // items sorted by cell
+  std::vector<uint32_t> m_cellIndex;  // cell of each pending item
+  std::vector<uint32_t> m_cellStart;  // first item of each cell, plus end
+  std::vector<Vec2> m_positions;      // item positions in sorted order
+  std::vector<float> m_radii;         // item radiuses in sorted order
+  std::vector<Vec2> m_motions;        // item motions in sorted order
+  mutable std::vector<Scratch> m_scratch = std::vector<Scratch>(1);
+  size_t m_reserved = 0;
+
+  int cellX(float x) const;
+  int cellY(float y) const;
+};
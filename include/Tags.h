@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef uint16_t TagId;
+
+// ids of the tags the game uses, registered in this order by TagRegistry
+namespace Tag {
+constexpr TagId Default = 0;
+constexpr TagId Player = 1;
+constexpr TagId Enemy = 2;
+constexpr TagId SmallEnemy = 3;
+constexpr TagId Bullet = 4;
+constexpr TagId BuiltinCount = 5;
+} // namespace Tag
+
+// Interns tag names to small integer ids. Only config loading and debug
+// output should need the string side, systems use the ids directly.
+class TagRegistry {
+  std::vector<std::string> m_names;
+  std::unordered_map<std::string, TagId> m_ids;
+
+public:
+  TagRegistry();
+
+  TagId intern(const std::string &name);
+  const std::string &name(TagId id) const;
+  size_t size() const;
+};
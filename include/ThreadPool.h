@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads running data-parallel loops. parallelFor cuts
+// [0, count) into chunks of at least minChunkSize items and deals them out to
+// the calling thread and the workers. Every participant owns a range of chunk
+// numbers and takes from its front; when its range runs dry it steals the back
+// half of another participant's range. Loops smaller than one chunk, or a
+// pool without workers, run inline on the caller.
+class ThreadPool {
+  // chunk range [begin, end) packed into one word so owner pops and thief
+  // steals are both a single compare-and-swap
+  struct alignas(64) Queue {
+    std::atomic<uint64_t> range{0};
+  };
+
+  std::vector<std::thread> m_workers;
+  std::unique_ptr<Queue[]> m_queues; // index 0 belongs to the caller
+  size_t m_minChunkSize = 1;
+
+  // current job, published under m_mutex
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  uint64_t m_epoch = 0;
+  bool m_jobOpen = false;
+  bool m_stopping = false;
+  void (*m_call)(void *context, size_t begin, size_t end) = nullptr;
+  void *m_context = nullptr;
+  size_t m_count = 0;
+  size_t m_chunkSize = 1;
+  std::atomic<size_t> m_remainingChunks{0};
+  std::atomic<size_t> m_activeWorkers{0};
+
+  void workerLoop(size_t queue);
+  void work(size_t queue);
+  bool popChunk(size_t queue, uint32_t &chunk);
+  bool stealChunks(size_t queue);
+  void run(size_t count, void (*call)(void *, size_t, size_t), void *context);
+
+public:
+  ThreadPool();
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // threads is the total including the calling thread, 0 picks one per core
+  void start(size_t threads, size_t minChunkSize);
+  void stop();
+  size_t threadCount() const;
+  // 0 on the thread that calls parallelFor (and any thread outside a pool),
+  // 1 to threadCount() - 1 on the workers
+  static size_t threadIndex();
+
+  // calls fn(begin, end) on disjoint ranges covering [0, count) and returns
+  // once all of them are done
+  template <typename F> void parallelFor(size_t count, F &&fn) {
+    if (m_workers.empty() || count <= m_minChunkSize) {
+      if (count > 0) {
+        fn(size_t(0), count);
+      }
+      return;
+    }
+    run(
+        count,
+        [](void *context, size_t begin, size_t end) {
+          typedef typename std::remove_reference<F>::type Fn;
+          (*static_cast<Fn *>(context))(begin, end);
+        },
+        &fn);
+  }
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Entity.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel of entity handles keyed by tick. Four levels of
+// 256 slots cover the whole 32 bit tick range: an entry goes into the level
+// of the highest byte in which its tick differs from the current one, and
+// drops a level each time the wheel reaches the start of its slot. Advancing
+// one tick touches the due entries and, every 256 ticks, one slot of the
+// level above, so the cost follows the number of expiring entries instead of
+// the number of scheduled ones. Entries are nodes of one array chained into
+// the slots, reserve() makes scheduling allocation free.
+class TimingWheel {
+  static constexpr uint32_t npos = UINT32_MAX;
+  static constexpr int levels = 4;
+  static constexpr int slotBits = 8;
+  static constexpr uint32_t slotMask = (1u << slotBits) - 1;
+
+  struct Node {
+    EntityHandle handle;
+    uint32_t tick;
+    uint32_t next;
+  };
+
+  std::vector<Node> m_nodes;
+  uint32_t m_free = npos; // chain of unused nodes
+  uint32_t m_slots[levels][1u << slotBits];
+  uint32_t m_now = 0;
+  size_t m_size = 0;
+
+  void insert(uint32_t node);
+
+public:
+  TimingWheel();
+
+  void reserve(size_t entries);
+  // removes every entry and sets the current tick
+  void clear(uint32_t now);
+  uint32_t now() const;
+  size_t size() const;
+
+  // handle comes out of advance() when the wheel reaches tick, a tick that
+  // is not in the future comes out at the next advance()
+  void schedule(EntityHandle handle, uint32_t tick);
+  // moves the wheel one tick on and appends the handles due at it to due
+  void advance(std::vector<EntityHandle> &due);
+};
@@ -1,26 +1,101 @@
 #pragma once
 
+#include <cmath>
+#include <cstddef>
+
+// 2D vector math, all inline so the hot loops get it without link time
+// optimisation. Everything but the square roots is constexpr.
 class Vec2 {
 public:
   float x = 0;
   float y = 0;
 
-  Vec2();
-  Vec2(float xin, float yin);
+  constexpr Vec2() noexcept = default;
+  constexpr Vec2(float xin, float yin) noexcept : x(xin), y(yin) {}
+
+  constexpr bool operator==(const Vec2 &rhs) const noexcept {
+    return x == rhs.x && y == rhs.y;
+  }
+  constexpr bool operator!=(const Vec2 &rhs) const noexcept {
+    return x != rhs.x || y != rhs.y;
+  }
 
-  bool operator==(const Vec2 &rhs) const;
-  bool operator!=(const Vec2 &rhs) const;
+  constexpr Vec2 operator+(const Vec2 &rhs) const noexcept {
+    return Vec2(x + rhs.x, y + rhs.y);
+  }
+  constexpr Vec2 operator-(const Vec2 &rhs) const noexcept {
+    return Vec2(x - rhs.x, y - rhs.y);
+  }
+  constexpr Vec2 operator/(const float val) const noexcept {
+    return Vec2(x / val, y / val);
+  }
+  constexpr Vec2 operator*(const float val) const noexcept {
+    return Vec2(x * val, y * val);
+  }
 
-  Vec2 operator+(const Vec2 &rhs) const;
-  Vec2 operator-(const Vec2 &rhs) const;
-  Vec2 operator/(const float val) const;
-  Vec2 operator*(const float val) const;
+  constexpr void operator+=(const Vec2 &rhs) noexcept {
+    x += rhs.x;
+    y += rhs.y;
+  }
+  constexpr void operator-=(const Vec2 &rhs) noexcept {
+    x -= rhs.x;
+    y -= rhs.y;
+  }
+  constexpr void operator*=(const float val) noexcept {
+    x *= val;
+    y *= val;
+  }
+  constexpr void operator/=(const float val) noexcept {
+    x /= val;
+    y /= val;
+  }
 
-  void operator+=(const Vec2 &rhs);
-  void operator-=(const Vec2 &rhs);
-  void operator*=(const float val);
-  void operator/=(const float val);
+  constexpr float dot(const Vec2 &rhs) const noexcept {
+    return x * rhs.x + y * rhs.y;
+  }
+  constexpr float lengthSquared() const noexcept { return x * x + y * y; }
+  float length() const noexcept { return std::sqrt(lengthSquared()); }
 
-  float dist(const Vec2 &rhs) const;
-  Vec2 normalizeToTarget(const Vec2 &target) const;
+  constexpr float distSquared(const Vec2 &rhs) const noexcept {
+    return (rhs - *this).lengthSquared();
+  }
+  float dist(const Vec2 &rhs) const noexcept {
+    return std::sqrt(distSquared(rhs));
+  }
+
+  // unit vector in the same direction, the zero vector stays zero instead of
+  // turning into NaNs
+  Vec2 normalized() const noexcept {
+    float lengthSq = lengthSquared();
+    if (!(lengthSq > 0)) {
+      return Vec2();
+    }
+    return *this / std::sqrt(lengthSq);
+  }
+  // unit vector from this point towards target, zero when they coincide
+  Vec2 normalizeToTarget(const Vec2 &target) const noexcept {
+    return (target - *this).normalized();
+  }
 };
+
+// Loops over arrays of vectors, written so the compiler vectorises them. The
+// bigger kernels with hand written SIMD live in SimdKernels.h.
+namespace Vec2Batch {
+
+// out[i] = a[i] - b[i], e.g. how far each position moved in a tick
+inline void subtract(const Vec2 *a, const Vec2 *b, Vec2 *out,
+                     size_t count) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = a[i] - b[i];
+  }
+}
+
+// out[i] = from[i] + (to[i] - from[i]) * t
+inline void lerp(const Vec2 *from, const Vec2 *to, float t, Vec2 *out,
+                 size_t count) noexcept {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = from[i] + (to[i] - from[i]) * t;
+  }
+}
+
+} // namespace Vec2Batch
@@ -0,0 +1,27 @@
+#include "../include/AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions so the game and the benchmarks
+// can count the allocations a frame makes. The cost is one relaxed atomic
+// increment per allocation. The array and nothrow forms of operator new
+// forward to these.
+static std::atomic<size_t> s_allocations(0);
+
+size_t allocationCount() {
+  return s_allocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(size_t size) {
+  s_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
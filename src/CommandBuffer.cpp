@@ -0,0 +1,49 @@
+#include "../include/CommandBuffer.h"
+
+CommandBuffer::Command CommandBuffer::makeCommand(Command::Type type) const {
+  Command command;
+  command.type = type;
+  command.tag = Tag::Default;
+  command.key = m_key;
+  command.sequence = static_cast<uint32_t>(m_commands.size());
+  return command;
+}
+
+void CommandBuffer::setOrderKey(uint64_t key) { m_key = key; }
+
+CommandBuffer::Pending CommandBuffer::create(TagId tag) {
+  Command command = makeCommand(Command::Create);
+  command.tag = tag;
+  m_commands.push_back(command);
+  m_created++;
+  Pending pending;
+  pending.command = command.sequence;
+  return pending;
+}
+
+void CommandBuffer::destroy(EntityHandle entity) {
+  Command command = makeCommand(Command::Destroy);
+  command.entity = entity;
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::addTransform(Pending entity, const CTransform &transform,
+                                 bool bounded) {
+  add(entity, TransformData{transform, bounded});
+}
+
+const std::vector<CommandBuffer::Command> &CommandBuffer::commands() const {
+  return m_commands;
+}
+
+size_t CommandBuffer::created() const { return m_created; }
+
+bool CommandBuffer::empty() const { return m_commands.empty(); }
+
+void CommandBuffer::clear() {
+  m_commands.clear();
+  m_key = 0;
+  m_created = 0;
+}
+
+void CommandBuffer::reserve(size_t commands) { m_commands.reserve(commands); }
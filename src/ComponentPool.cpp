@@ -0,0 +1,158 @@
+#include "../include/ComponentPool.h"
+
+bool SparseSet::has(uint32_t entity) const {
+  return entity < m_sparse.size() && m_sparse[entity] != npos;
+}
+
+uint32_t SparseSet::indexOf(uint32_t entity) const { return m_sparse[entity]; }
+
+size_t SparseSet::size() const { return m_dense.size(); }
+
+const std::vector<uint32_t> &SparseSet::entities() const { return m_dense; }
+
+void SparseSet::reserve(size_t entities) {
+  m_sparse.reserve(entities);
+  m_dense.reserve(entities);
+}
+
+void SparseSet::save(SnapshotWriter &writer) const {
+  writer.writeArray(m_sparse);
+  writer.writeArray(m_dense);
+}
+
+bool SparseSet::load(SnapshotReader &reader) {
+  return reader.readArray(m_sparse) && reader.readArray(m_dense);
+}
+
+bool SparseSet::consistent(size_t entityCount) const {
+  if (m_sparse.size() > entityCount) {
+    return false;
+  }
+  for (size_t slot = 0; slot < m_dense.size(); ++slot) {
+    uint32_t entity = m_dense[slot];
+    if (entity >= m_sparse.size() || m_sparse[entity] != slot) {
+      return false;
+    }
+  }
+  // each slot is claimed by one entity, so a sparse entry that passes is
+  // the only one pointing at its slot
+  for (size_t entity = 0; entity < m_sparse.size(); ++entity) {
+    uint32_t slot = m_sparse[entity];
+    if (slot != npos && (slot >= m_dense.size() || m_dense[slot] != entity)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t SparseSet::insertEntity(uint32_t entity) {
+  if (entity >= m_sparse.size()) {
+    m_sparse.resize(entity + 1, npos);
+  }
+  m_sparse[entity] = static_cast<uint32_t>(m_dense.size());
+  m_dense.push_back(entity);
+  return m_sparse[entity];
+}
+
+uint32_t SparseSet::eraseEntity(uint32_t entity) {
+  uint32_t slot = m_sparse[entity];
+  uint32_t last = m_dense.back();
+  m_dense[slot] = last;
+  m_sparse[last] = slot;
+  m_dense.pop_back();
+  m_sparse[entity] = npos;
+  return slot;
+}
+
+void SparseSet::swapSlots(uint32_t a, uint32_t b) {
+  std::swap(m_dense[a], m_dense[b]);
+  m_sparse[m_dense[a]] = a;
+  m_sparse[m_dense[b]] = b;
+}
+
+void TransformPool::swapTransforms(uint32_t a, uint32_t b) {
+  swapSlots(a, b);
+  std::swap(positions[a], positions[b]);
+  std::swap(previousPositions[a], previousPositions[b]);
+  std::swap(velocities[a], velocities[b]);
+  std::swap(angles[a], angles[b]);
+}
+
+TransformPool::Ref TransformPool::add(uint32_t entity,
+                                      const CTransform &transform,
+                                      bool bounded) {
+  if (!has(entity)) {
+    uint32_t slot = insertEntity(entity);
+    positions.push_back(transform.pos);
+    previousPositions.push_back(transform.pos);
+    velocities.push_back(transform.velocity);
+    angles.push_back(transform.angle);
+    if (bounded) {
+      // grow the bounded range by swapping with its first unbounded slot
+      swapTransforms(slot, static_cast<uint32_t>(m_boundedCount++));
+    }
+  }
+  Ref ref = get(entity);
+  ref.pos = transform.pos;
+  ref.velocity = transform.velocity;
+  ref.angle = transform.angle;
+  return ref;
+}
+
+void TransformPool::remove(uint32_t entity) {
+  if (!has(entity)) {
+    return;
+  }
+  if (indexOf(entity) < m_boundedCount) {
+    // move the entity to the end of the bounded range and shrink it, so the
+    // swap with the last slot below only moves unbounded transforms
+    swapTransforms(indexOf(entity), static_cast<uint32_t>(--m_boundedCount));
+  }
+  uint32_t slot = eraseEntity(entity);
+  positions[slot] = positions.back();
+  previousPositions[slot] = previousPositions.back();
+  velocities[slot] = velocities.back();
+  angles[slot] = angles.back();
+  positions.pop_back();
+  previousPositions.pop_back();
+  velocities.pop_back();
+  angles.pop_back();
+}
+
+TransformPool::Ref TransformPool::get(uint32_t entity) {
+  uint32_t slot = indexOf(entity);
+  return Ref{positions[slot], velocities[slot], angles[slot]};
+}
+
+size_t TransformPool::boundedCount() const { return m_boundedCount; }
+
+void TransformPool::reserve(size_t entities) {
+  SparseSet::reserve(entities);
+  positions.reserve(entities);
+  previousPositions.reserve(entities);
+  velocities.reserve(entities);
+  angles.reserve(entities);
+}
+
+void TransformPool::save(SnapshotWriter &writer) const {
+  SparseSet::save(writer);
+  writer.write(static_cast<uint64_t>(m_boundedCount));
+  writer.writeArray(positions);
+  writer.writeArray(previousPositions);
+  writer.writeArray(velocities);
+  writer.writeArray(angles);
+}
+
+bool TransformPool::load(SnapshotReader &reader) {
+  uint64_t bounded = 0;
+  if (!SparseSet::load(reader) || !reader.read(bounded) ||
+      !reader.readArray(positions) || !reader.readArray(previousPositions) ||
+      !reader.readArray(velocities) || !reader.readArray(angles)) {
+    return false;
+  }
+  m_boundedCount = static_cast<size_t>(bounded);
+  size_t count = size();
+  return m_boundedCount <= count && positions.size() == count &&
+         previousPositions.size() == count && velocities.size() == count &&
+         angles.size() == count;
+}
@@ -0,0 +1,370 @@
+#include "../include/Config.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CONFIG_USE_MMAP 1
+#endif
+
+static_assert(std::is_trivially_copyable<GameConfig>::value,
+              "GameConfig is copied as raw bytes");
+
+std::string ConfigError::str() const {
+  std::string result = file;
+  if (line > 0) {
+    result += ":" + std::to_string(line);
+  }
+  result += ": ";
+  if (!field.empty()) {
+    result += field + ": ";
+  }
+  return result + message;
+}
+
+namespace {
+
+// one value of a config line, with the range it has to be in
+struct Field {
+  enum Type { Int, Float, String };
+
+  const char *name;
+  Type type;
+  void *value;
+  double min;
+  double max;
+};
+
+Field intField(const char *name, int &value, double min, double max) {
+  return Field{name, Field::Int, &value, min, max};
+}
+
+Field floatField(const char *name, float &value, double min, double max) {
+  return Field{name, Field::Float, &value, min, max};
+}
+
+Field stringField(const char *name, char *value, size_t size) {
+  return Field{name, Field::String, value, 0, static_cast<double>(size - 1)};
+}
+
+// the fields of each section in the order they appear on the line
+std::vector<Field> sectionFields(const std::string &section, GameConfig &c) {
+  const double maxSize = 1 << 20;
+  if (section == "Window") {
+    return {intField("W", c.windowWidth, 1, 16384),
+            intField("H", c.windowHeight, 1, 16384),
+            intField("FL", c.frameLimit, 0, 1000),
+            intField("FS", c.fullscreen, 0, 1)};
+  }
+  if (section == "World") {
+    return {intField("W", c.worldWidth, 0, maxSize),
+            intField("H", c.worldHeight, 0, maxSize)};
+  }
+  if (section == "Threads") {
+    return {intField("T", c.threadCount, 0, 256),
+            intField("C", c.minChunkSize, 1, maxSize)};
+  }
+  if (section == "Simulation") {
+    return {intField("R", c.tickRate, 0, 10000),
+            intField("M", c.maxTicksPerFrame, 1, 1000)};
+  }
+  if (section == "Entities") {
+    return {intField("N", c.entityCapacity, 0, 1 << 26)};
+  }
+  if (section == "StableOrder") {
+    return {intField("S", c.stableOrder, 0, 1)};
+  }
+  if (section == "RenderThread") {
+    return {intField("R", c.renderThread, 0, 1)};
+  }
+  if (section == "Latency") {
+    return {intField("L", c.lowLatency, 0, 1)};
+  }
+  if (section == "Particles") {
+    return {intField("N", c.particleCapacity, 0, 1 << 24),
+            intField("K", c.particlesPerKill, 0, 1 << 16),
+            intField("L", c.particleLifetime, 1, maxSize),
+            floatField("S", c.particleSpeed, 0, maxSize)};
+  }
+  if (section == "Waves") {
+    WaveConfig &w = c.wave;
+    return {intField("K", w.K, 0, 1 << 24), intField("I", w.I, 1, maxSize),
+            intField("G", w.G, 0, 1 << 24), floatField("F", w.F, 0, 1000),
+            intField("C", w.C, 0, 1 << 26)};
+  }
+  if (section == "Lod") {
+    return {floatField("O", c.lodOutline, 0, maxSize),
+            floatField("P", c.lodPolygon, 0, maxSize),
+            intField("V", c.lodPoints, 3, 360)};
+  }
+  if (section == "Rewind") {
+    return {intField("S", c.rewindSeconds, 0, 3600)};
+  }
+  if (section == "Font") {
+    return {stringField("F", c.fontPath, sizeof(c.fontPath)),
+            intField("S", c.fontSize, 1, 512), intField("R", c.fontR, 0, 255),
+            intField("G", c.fontG, 0, 255), intField("B", c.fontB, 0, 255)};
+  }
+  if (section == "Player") {
+    PlayerConfig &p = c.player;
+    return {intField("SR", p.SR, 1, maxSize),
+            intField("CR", p.CR, 1, maxSize),
+            floatField("S", p.S, 0, maxSize),
+            intField("FR", p.FR, 0, 255),
+            intField("FG", p.FG, 0, 255),
+            intField("FB", p.FB, 0, 255),
+            intField("OR", p.OR, 0, 255),
+            intField("OG", p.OG, 0, 255),
+            intField("OB", p.OB, 0, 255),
+            intField("OT", p.OT, 0, 1000),
+            intField("V", p.V, 3, 360)};
+  }
+  if (section == "Enemy") {
+    EnemyConfig &e = c.enemy;
+    return {intField("SR", e.SR, 1, maxSize),
+            intField("CR", e.CR, 1, maxSize),
+            floatField("SMIN", e.SMIN, 0, maxSize),
+            floatField("SMAX", e.SMAX, 0, maxSize),
+            intField("OR", e.OR, 0, 255),
+            intField("OG", e.OG, 0, 255),
+            intField("OB", e.OB, 0, 255),
+            intField("OT", e.OT, 0, 1000),
+            intField("VMIN", e.VMIN, 3, 360),
+            intField("VMAX", e.VMAX, 3, 360),
+            intField("L", e.L, 1, maxSize),
+            intField("SI", e.SI, 1, maxSize)};
+  }
+  if (section == "Bullet") {
+    BulletConfig &b = c.bullet;
+    return {intField("SR", b.SR, 1, maxSize),
+            intField("CR", b.CR, 1, maxSize),
+            floatField("S", b.S, 0, maxSize),
+            intField("FR", b.FR, 0, 255),
+            intField("FG", b.FG, 0, 255),
+            intField("FB", b.FB, 0, 255),
+            intField("OR", b.OR, 0, 255),
+            intField("OG", b.OG, 0, 255),
+            intField("OB", b.OB, 0, 255),
+            intField("OT", b.OT, 0, 1000),
+            intField("V", b.V, 3, 360),
+            intField("L", b.L, 1, maxSize)};
+  }
+  return {};
+}
+
+bool fail(ConfigError &error, const std::string &file, int line,
+          const std::string &field, const std::string &message) {
+  error.file = file;
+  error.line = line;
+  error.field = field;
+  error.message = message;
+  return false;
+}
+
+bool parseField(const Field &field, const std::string &token,
+                const std::string &section, const std::string &file,
+                int line, ConfigError &error) {
+  std::string name = section + " " + field.name;
+  if (field.type == Field::String) {
+    if (token.size() > field.max) {
+      return fail(error, file, line, name,
+                  "longer than " + std::to_string(int(field.max)) +
+                      " characters");
+    }
+    std::memcpy(field.value, token.c_str(), token.size() + 1);
+    return true;
+  }
+
+  const char *begin = token.c_str();
+  char *end = nullptr;
+  errno = 0;
+  double value = field.type == Field::Int ? std::strtol(begin, &end, 10)
+                                          : std::strtod(begin, &end);
+  if (end == begin || *end != '\0' || errno == ERANGE) {
+    return fail(error, file, line, name,
+                std::string("expected ") +
+                    (field.type == Field::Int ? "an integer" : "a number") +
+                    ", got '" + token + "'");
+  }
+  if (value < field.min || value > field.max) {
+    std::ostringstream range;
+    range << token << " is outside [" << field.min << ", " << field.max
+          << "]";
+    return fail(error, file, line, name, range.str());
+  }
+  if (field.type == Field::Int) {
+    *static_cast<int *>(field.value) = static_cast<int>(value);
+  } else {
+    *static_cast<float *>(field.value) = static_cast<float>(value);
+  }
+  return true;
+}
+
+// compiled format: this header followed by the GameConfig bytes
+struct BlobHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t size; // sizeof(GameConfig) of the build that wrote it
+  uint64_t hash; // FNV-1a of the payload
+};
+
+const char blobMagic[4] = {'S', 'B', 'C', 'F'};
+const uint32_t blobVersion = 7;
+
+uint64_t hashBytes(const void *data, size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// copies the payload of a compiled config, false when data is not one
+bool readBlob(const char *data, size_t size, const std::string &path,
+              GameConfig &config, ConfigError &error) {
+  BlobHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (header.version != blobVersion || header.size != sizeof(GameConfig) ||
+      size != sizeof(BlobHeader) + sizeof(GameConfig)) {
+    return fail(error, path, 0, "",
+                "compiled config was written by a different build, "
+                "compile it again");
+  }
+  const char *payload = data + sizeof(BlobHeader);
+  if (hashBytes(payload, sizeof(GameConfig)) != header.hash) {
+    return fail(error, path, 0, "", "compiled config is corrupt");
+  }
+  std::memcpy(&config, payload, sizeof(GameConfig));
+  return true;
+}
+
+} // namespace
+
+bool parseConfig(const std::string &text, const std::string &file,
+                 GameConfig &config, ConfigError &error) {
+  GameConfig parsed;
+  bool seen[4] = {false, false, false, false};
+  const char *required[4] = {"Window", "Player", "Enemy", "Bullet"};
+
+  std::istringstream lines(text);
+  std::string lineText;
+  int line = 0;
+  while (std::getline(lines, lineText)) {
+    line++;
+    lineText = lineText.substr(0, lineText.find('#'));
+    std::istringstream tokens(lineText);
+    std::string section;
+    if (!(tokens >> section)) {
+      continue; // blank or comment
+    }
+
+    std::vector<Field> fields = sectionFields(section, parsed);
+    if (fields.empty()) {
+      return fail(error, file, line, section, "unknown config line");
+    }
+    for (int i = 0; i < 4; ++i) {
+      seen[i] = seen[i] || section == required[i];
+    }
+
+    std::string token;
+    for (const Field &field : fields) {
+      if (!(tokens >> token)) {
+        return fail(error, file, line, section + " " + field.name,
+                    "missing value");
+      }
+      if (!parseField(field, token, section, file, line, error)) {
+        return false;
+      }
+    }
+    if (tokens >> token) {
+      return fail(error, file, line, section,
+                  "unexpected extra value '" + token + "'");
+    }
+
+    if (section == "Enemy" && parsed.enemy.SMIN > parsed.enemy.SMAX) {
+      return fail(error, file, line, "Enemy SMIN", "larger than SMAX");
+    }
+    if (section == "Enemy" && parsed.enemy.VMIN > parsed.enemy.VMAX) {
+      return fail(error, file, line, "Enemy VMIN", "larger than VMAX");
+    }
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    if (!seen[i]) {
+      return fail(error, file, 0, required[i], "required line is missing");
+    }
+  }
+  config = parsed;
+  return true;
+}
+
+bool loadConfig(const std::string &path, GameConfig &config,
+                ConfigError &error) {
+#ifdef CONFIG_USE_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return fail(error, path, 0, "", std::strerror(errno));
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return fail(error, path, 0, "", "empty or unreadable file");
+  }
+  size_t size = static_cast<size_t>(info.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return fail(error, path, 0, "", std::strerror(errno));
+  }
+  const char *data = static_cast<const char *>(mapping);
+  bool ok;
+  if (size >= sizeof(BlobHeader) &&
+      std::memcmp(data, blobMagic, sizeof(blobMagic)) == 0) {
+    ok = readBlob(data, size, path, config, error);
+  } else {
+    ok = parseConfig(std::string(data, size), path, config, error);
+  }
+  munmap(mapping, size);
+  return ok;
+#else
+  std::ifstream input(path, std::ios::binary);
+  if (!input.is_open()) {
+    return fail(error, path, 0, "", "could not open file");
+  }
+  std::string data((std::istreambuf_iterator<char>(input)),
+                   std::istreambuf_iterator<char>());
+  if (data.size() >= sizeof(BlobHeader) &&
+      std::memcmp(data.data(), blobMagic, sizeof(blobMagic)) == 0) {
+    return readBlob(data.data(), data.size(), path, config, error);
+  }
+  return parseConfig(data, path, config, error);
+#endif
+}
+
+bool compileConfig(const GameConfig &config, const std::string &path,
+                   ConfigError &error) {
+  BlobHeader header;
+  std::memcpy(header.magic, blobMagic, sizeof(blobMagic));
+  header.version = blobVersion;
+  header.size = sizeof(GameConfig);
+  header.hash = hashBytes(&config, sizeof(GameConfig));
+
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  output.write(reinterpret_cast<const char *>(&config), sizeof(GameConfig));
+  if (!output) {
+    return fail(error, path, 0, "", "could not write file");
+  }
+  return true;
+}
@@ -0,0 +1,102 @@
+#include "../include/ConfigWatcher.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ConfigWatcher::~ConfigWatcher() { stop(); }
+
+bool ConfigWatcher::start(const std::string &path) {
+#ifdef __linux__
+  stop();
+  m_path = path;
+  // editors often save by writing a new file and renaming it over the old
+  // one, so the directory is watched rather than the file itself
+  size_t slash = path.find_last_of('/');
+  std::string directory =
+      slash == std::string::npos ? "." : path.substr(0, slash + 1);
+  m_fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+
+  m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_inotify < 0) {
+    return false;
+  }
+  if (inotify_add_watch(m_inotify, directory.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+    close(m_inotify);
+    m_inotify = -1;
+    return false;
+  }
+  m_stopping = false;
+  m_thread = std::thread(&ConfigWatcher::watchLoop, this);
+  return true;
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+void ConfigWatcher::stop() {
+  if (!m_thread.joinable()) {
+    return;
+  }
+  m_stopping = true;
+  m_thread.join();
+#ifdef __linux__
+  close(m_inotify);
+#endif
+  m_inotify = -1;
+}
+
+bool ConfigWatcher::poll(GameConfig &config) {
+  if (!m_hasPending.load(std::memory_order_acquire)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  config = m_pending;
+  m_hasPending.store(false, std::memory_order_release);
+  return true;
+}
+
+void ConfigWatcher::reload() {
+  GameConfig config;
+  ConfigError error;
+  if (!loadConfig(m_path, config, error)) {
+    std::cerr << "Config not reloaded: " << error.str() << std::endl;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pending = config;
+  m_hasPending.store(true, std::memory_order_release);
+}
+
+void ConfigWatcher::watchLoop() {
+#ifdef __linux__
+  alignas(inotify_event) char buffer[4096];
+  while (!m_stopping) {
+    // wake up regularly to notice stop()
+    pollfd descriptor = {m_inotify, POLLIN, 0};
+    if (::poll(&descriptor, 1, 200) <= 0) {
+      continue;
+    }
+    bool changed = false;
+    ssize_t length;
+    while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+      for (char *at = buffer; at < buffer + length;) {
+        inotify_event *event = reinterpret_cast<inotify_event *>(at);
+        if (event->len > 0 && m_fileName == event->name) {
+          changed = true;
+        }
+        at += sizeof(inotify_event) + event->len;
+      }
+    }
+    if (changed) {
+      reload();
+    }
+  }
+#endif
+}
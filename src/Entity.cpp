@@ -1,32 +1,29 @@
-#include <string>
-
 #include "../include/Entity.h"
+#include "../include/EntityPool.h"
 
-Entity::Entity(const size_t id, const std::string &tag)
-    : m_id(id), m_tag(tag) {}
+Entity::Entity(const size_t id, const uint32_t index, const TagId tag,
+               EntityPool *pool)
+    : m_id(id), m_index(index), m_tag(tag), m_pool(pool) {}
 
 bool Entity::isActive() const { return m_active; }
 
-const std::string &Entity::tag() const { return m_tag; }
+TagId Entity::tag() const { return m_tag; }
 
 const size_t Entity::id() const { return m_id; }
 
-void Entity::destroy() { m_active = false; }
+uint32_t Entity::index() const { return m_index; }
+
+EntityHandle Entity::handle() const {
+  EntityHandle handle;
+  handle.index = m_index;
+  handle.generation = m_generation;
+  return handle;
+}
 
-void Entity::updateLifeSpanAndColor() {
-  int lifeSpanValue = cLifespan->remaining;
-  int lifeSpanTotal = cLifespan->total;
-  if (lifeSpanValue > 0) {
-    float progress = static_cast<float>(lifeSpanValue) / lifeSpanTotal;
-    sf::Uint8 alpha = static_cast<sf::Uint8>(255 * (progress));
-    sf::Color entityColor = cShape->circle.getFillColor();
-    sf::Color entityOutLineColor = cShape->circle.getOutlineColor();
-    entityColor.a = alpha;
-    entityOutLineColor.a = alpha;
-    cShape->circle.setFillColor(entityColor);
-    cShape->circle.setOutlineColor(entityOutLineColor);
-    cLifespan->remaining--;
-  } else if (lifeSpanValue <= 0) {
-    destroy();
+void Entity::destroy() {
+  // dead and released entities are inactive, destroying them again is a no-op
+  if (m_active) {
+    m_active = false;
+    m_pool->queueDeath(*this);
   }
 }
@@ -1,47 +1,447 @@
 #include "../include/EntityManager.h"
+#include <algorithm>
 #include <iostream>
-#include <memory>
 
-EntityManager::EntityManager() {}
+EntityManager::EntityManager()
+    : m_entityMap(m_tags.size()), m_commandBuffers(1) {}
 
 void EntityManager::update() {
+  applyCommands();
+
   // Adding entities from m_entitiesToAdd the proper location(s)
   //       - adding them to the vector of all entities
   //       - adding them to the vector inside the map, with the tag as a key
+  //       - remembering both positions so the entity can be removed
+  //         without searching for it
   for (auto &entityVector : m_entitiesToAdd) {
+    EntityVec &tagVector = m_entityMap[entityVector->m_tag];
+    entityVector->m_allIndex = static_cast<uint32_t>(m_entities.size());
+    entityVector->m_tagIndex = static_cast<uint32_t>(tagVector.size());
     m_entities.push_back(entityVector);
-    m_entityMap[entityVector->m_tag].push_back(entityVector);
+    tagVector.push_back(entityVector);
   }
   m_entitiesToAdd.clear();
 
-  // remove dead entities from the vector of all entities
-  removeDeadEntities(m_entities);
+  // only the entities destroyed since the last update are visited, so the
+  // cost follows the number of deaths rather than the population
+  size_t count = m_pool.dyingCount();
+  if (count == 0) {
+    return;
+  }
+  Entity **dying = m_pool.dying();
+  // the queue order depends on which thread destroyed what first, sort it
+  // so the vectors and the slot reuse come out the same on every run
+  std::sort(dying, dying + count, [](const Entity *a, const Entity *b) {
+    return a->m_id < b->m_id;
+  });
+  removeDeadEntities(dying, count);
+
+  // release the components and slots of dead entities
+  for (size_t i = 0; i < count; ++i) {
+    releaseEntity(*dying[i]);
+  }
+  m_pool.clearDying();
+}
+
+// removes vec[slot], swapping the last entity into its place
+static void swapRemove(EntityVec &vec, uint32_t slot,
+                       uint32_t Entity::*position) {
+  Entity *last = vec.back();
+  vec[slot] = last;
+  last->*position = slot;
+  vec.pop_back();
+}
+
+// removes the inactive entities behind first, keeping the order of the rest
+static void stableRemove(EntityVec &vec, uint32_t first,
+                         uint32_t Entity::*position) {
+  uint32_t kept = first;
+  for (size_t i = first; i < vec.size(); ++i) {
+    if (vec[i]->isActive()) {
+      vec[kept] = vec[i];
+      vec[kept]->*position = kept;
+      kept++;
+    }
+  }
+  vec.resize(kept);
+}
+
+void EntityManager::removeDeadEntities(Entity **dying, size_t count) {
+  // Remove the dying entities from the vector of all entities and from
+  // their tag vector, this is called by the update() function
+  if (!m_stableOrder) {
+    for (size_t i = 0; i < count; ++i) {
+      Entity &entity = *dying[i];
+      swapRemove(m_entities, entity.m_allIndex, &Entity::m_allIndex);
+      swapRemove(m_entityMap[entity.m_tag], entity.m_tagIndex,
+                 &Entity::m_tagIndex);
+    }
+    return;
+  }
+
+  // compact each vector once, starting from its first dead entity
+  uint32_t firstAll = UINT32_MAX;
+  m_firstDead.assign(m_entityMap.size(), UINT32_MAX);
+  for (size_t i = 0; i < count; ++i) {
+    Entity &entity = *dying[i];
+    firstAll = std::min(firstAll, entity.m_allIndex);
+    m_firstDead[entity.m_tag] =
+        std::min(m_firstDead[entity.m_tag], entity.m_tagIndex);
+  }
+  stableRemove(m_entities, firstAll, &Entity::m_allIndex);
+  for (size_t tag = 0; tag < m_entityMap.size(); ++tag) {
+    if (m_firstDead[tag] != UINT32_MAX) {
+      stableRemove(m_entityMap[tag], m_firstDead[tag], &Entity::m_tagIndex);
+    }
+  }
+}
+
+void EntityManager::setStableOrder(bool stable) { m_stableOrder = stable; }
+
+void EntityManager::setThreadCount(size_t count) {
+  m_commandBuffers.resize(std::max<size_t>(count, 1));
+  for (auto &buffer : m_commandBuffers) {
+    buffer.reserve(m_reserved);
+  }
+  m_commandOrder.reserve(m_reserved * m_commandBuffers.size());
+  m_commandEntities.reserve(m_reserved * m_commandBuffers.size());
+}
+
+CommandBuffer &EntityManager::commands(size_t thread) {
+  return m_commandBuffers[thread];
+}
+
+void EntityManager::applyCommands() {
+  // merge the buffers by (key, thread, sequence), the order a single thread
+  // would have recorded them in if it had visited the keys in order
+  m_commandOrder.clear();
+  m_commandEntities.clear();
+  for (size_t thread = 0; thread < m_commandBuffers.size(); ++thread) {
+    for (const auto &command : m_commandBuffers[thread].commands()) {
+      m_commandOrder.push_back(
+          CommandRef{command.key, static_cast<uint32_t>(thread),
+                     command.sequence,
+                     static_cast<uint32_t>(m_commandOrder.size())});
+    }
+  }
+  if (m_commandOrder.empty()) {
+    return;
+  }
+  std::sort(m_commandOrder.begin(), m_commandOrder.end(),
+            [](const CommandRef &a, const CommandRef &b) {
+              if (a.key != b.key) {
+                return a.key < b.key;
+              }
+              if (a.thread != b.thread) {
+                return a.thread < b.thread;
+              }
+              return a.sequence < b.sequence;
+            });
+
+  // each buffer has a range of m_commandEntities starting at slot - sequence
+  m_commandEntities.resize(m_commandOrder.size(), nullptr);
+  for (const CommandRef &ref : m_commandOrder) {
+    size_t base = ref.slot - ref.sequence;
+    const auto &command =
+        m_commandBuffers[ref.thread].commands()[ref.sequence];
+    Entity *target;
+    if (command.type == CommandBuffer::Command::Create) {
+      target = addEntity(command.tag);
+      m_commandEntities[ref.slot] = target;
+    } else if (command.pending.command != UINT32_MAX) {
+      target = m_commandEntities[base + command.pending.command];
+    } else {
+      // the entity may have died since the command was recorded
+      target = getEntity(command.entity);
+    }
+    if (target != nullptr && target->isActive()) {
+      applyCommand(command, target);
+    }
+  }
+
+  for (auto &buffer : m_commandBuffers) {
+    buffer.clear();
+  }
+}
+
+void EntityManager::applyCommand(const CommandBuffer::Command &command,
+                                 Entity *target) {
+  typedef CommandBuffer::TransformData TransformData;
+  if (command.type == CommandBuffer::Command::Destroy) {
+    target->destroy();
+    return;
+  }
+  uint32_t index = target->m_index;
+  const auto &component = command.component;
+  if (auto *transform = std::get_if<TransformData>(&component)) {
+    m_transforms.add(index, transform->transform, transform->bounded);
+  } else if (auto *shape = std::get_if<CShape>(&component)) {
+    m_shapes.add(index, *shape);
+  } else if (auto *collision = std::get_if<CCollision>(&component)) {
+    m_collisions.add(index, *collision);
+  } else if (auto *lifespan = std::get_if<CLifespan>(&component)) {
+    startLifespan(*target, *lifespan);
+  } else if (auto *input = std::get_if<CInput>(&component)) {
+    m_inputs.add(index, *input);
+  } else if (auto *score = std::get_if<CScore>(&component)) {
+    m_scores.add(index, *score);
+  }
+}
+
+void EntityManager::reserve(size_t count) {
+  m_reserved = count;
+  setThreadCount(m_commandBuffers.size());
+  m_entities.reserve(count);
+  m_entitiesToAdd.reserve(count);
+  for (auto &entityVec : m_entityMap) {
+    entityVec.reserve(count);
+  }
+  m_pool.reserve(count);
+  m_transforms.reserve(count);
+  m_shapes.reserve(count);
+  m_collisions.reserve(count);
+  m_inputs.reserve(count);
+  m_scores.reserve(count);
+  m_lifespans.reserve(count);
+  m_expiries.reserve(count);
+  m_expired.reserve(count);
+  // a load swaps these with the live pools
+  m_loading.entities.reserve(count);
+  m_loading.tagged.resize(m_entityMap.size());
+  for (std::vector<uint32_t> &entities : m_loading.tagged) {
+    entities.reserve(count);
+  }
+  m_loading.transforms.reserve(count);
+  m_loading.shapes.reserve(count);
+  m_loading.collisions.reserve(count);
+  m_loading.inputs.reserve(count);
+  m_loading.scores.reserve(count);
+  m_loading.lifespans.reserve(count);
+}
+
+void EntityManager::startLifespan(Entity &entity, const CLifespan &lifespan) {
+  // the entity lives through total more expireLifespans() calls and dies in
+  // the one after
+  CLifespan &added = m_lifespans.add(entity.m_index, lifespan);
+  added.start = m_expiries.now() + 1;
+  m_expiries.schedule(entity.handle(), added.start + added.total);
+}
+
+void EntityManager::addLifespan(uint32_t entity, int total) {
+  startLifespan(m_pool.at(entity), CLifespan(total));
+}
+
+void EntityManager::expireLifespans() {
+  m_expired.clear();
+  m_expiries.advance(m_expired);
+  for (EntityHandle handle : m_expired) {
+    // entities killed before their time are skipped, a released slot has a
+    // new generation
+    Entity *entity = getEntity(handle);
+    if (entity != nullptr && entity->isActive()) {
+      entity->destroy();
+    }
+  }
+}
+
+uint32_t EntityManager::lifespanTick() const { return m_expiries.now(); }
+
+// entity vectors are stored as slot indices
+static void saveEntities(SnapshotWriter &writer, const EntityVec &entities,
+                         std::vector<uint32_t> &indices) {
+  indices.clear();
+  for (const Entity *entity : entities) {
+    indices.push_back(entity->index());
+  }
+  writer.writeArray(indices);
+}
+
+void EntityManager::save(SnapshotWriter &writer) {
+  writer.write(static_cast<uint64_t>(m_totalEntities));
+  writer.write(static_cast<uint32_t>(m_entityMap.size()));
+  writer.write(m_expiries.now());
+  m_pool.save(writer);
+  saveEntities(writer, m_entities, m_indices);
+  for (const EntityVec &entities : m_entityMap) {
+    saveEntities(writer, entities, m_indices);
+  }
+  m_transforms.save(writer);
+  m_shapes.save(writer);
+  m_collisions.save(writer);
+  m_inputs.save(writer);
+  m_scores.save(writer);
+  m_lifespans.save(writer);
+}
+
+void EntityManager::requireComponents(TagId tag, uint8_t components) {
+  if (tag >= m_requiredComponents.size()) {
+    m_requiredComponents.resize(tag + 1, 0);
+  }
+  m_requiredComponents[tag] = components;
+}
+
+bool EntityManager::prepareLoad(SnapshotReader &reader) {
+  uint32_t tagCount = 0;
+  if (!reader.read(m_loading.totalEntities) || !reader.read(tagCount) ||
+      tagCount != m_entityMap.size() ||
+      !reader.read(m_loading.lifespanTick) || !m_pool.prepareLoad(reader) ||
+      !reader.readArray(m_loading.entities)) {
+    return false;
+  }
+  m_loading.tagged.resize(tagCount);
+  for (std::vector<uint32_t> &entities : m_loading.tagged) {
+    if (!reader.readArray(entities)) {
+      return false;
+    }
+  }
+  return m_loading.transforms.load(reader) &&
+         m_loading.shapes.load(reader) && m_loading.collisions.load(reader) &&
+         m_loading.inputs.load(reader) && m_loading.scores.load(reader) &&
+         m_loading.lifespans.load(reader) && checkLoading();
+}
+
+bool EntityManager::checkLoading() const {
+  // The entity vectors and the positions the slots keep in them have to
+  // agree, removal relies on them. Every live slot is in the vector of all
+  // entities at its allIndex and in its tag's vector at its tagIndex, and
+  // nothing else is in either.
+  const std::vector<EntityPool::SlotState> &slots = m_pool.loadedSlots();
+  const std::vector<uint32_t> &all = m_loading.entities;
+  for (size_t i = 0; i < all.size(); ++i) {
+    if (all[i] >= slots.size()) {
+      return false;
+    }
+    const EntityPool::SlotState &slot = slots[all[i]];
+    if (slot.active == 0 || slot.allIndex != i ||
+        slot.tag >= m_loading.tagged.size()) {
+      return false;
+    }
+  }
+  size_t tagged = 0;
+  for (size_t tag = 0; tag < m_loading.tagged.size(); ++tag) {
+    const std::vector<uint32_t> &entities = m_loading.tagged[tag];
+    for (size_t i = 0; i < entities.size(); ++i) {
+      if (entities[i] >= slots.size()) {
+        return false;
+      }
+      const EntityPool::SlotState &slot = slots[entities[i]];
+      if (slot.tag != tag || slot.tagIndex != i ||
+          slot.allIndex >= all.size() || all[slot.allIndex] != entities[i]) {
+        return false;
+      }
+    }
+    tagged += entities.size();
+  }
+  size_t live = 0;
+  for (const EntityPool::SlotState &slot : slots) {
+    live += slot.active != 0;
+  }
+  if (tagged != all.size() || live != all.size()) {
+    return false;
+  }
+
+  // components only belong to live entities, and each entity has the ones
+  // its tag needs, the systems read them without checking. The pools are
+  // in the order of the Component bits.
+  const SparseSet *pools[] = {&m_loading.transforms, &m_loading.shapes,
+                              &m_loading.collisions, &m_loading.inputs,
+                              &m_loading.scores,     &m_loading.lifespans};
+  for (const SparseSet *pool : pools) {
+    if (!pool->consistent(slots.size())) {
+      return false;
+    }
+    for (uint32_t entity : pool->entities()) {
+      if (slots[entity].active == 0) {
+        return false;
+      }
+    }
+  }
+  for (uint32_t entity : all) {
+    TagId tag = slots[entity].tag;
+    uint8_t required =
+        tag < m_requiredComponents.size() ? m_requiredComponents[tag] : 0;
+    for (size_t component = 0; component < 6; ++component) {
+      if ((required & (1u << component)) != 0 &&
+          !pools[component]->has(entity)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
 
-  // remove dead entities from each vector in the entity map
-  // C++17 way of iterating through [key,value] pairs in a map
-  for (auto &[tag, entityVec] : m_entityMap) {
-    removeDeadEntities(entityVec);
+bool EntityManager::loadedEntity(EntityHandle handle, TagId tag) const {
+  const std::vector<EntityPool::SlotState> &slots = m_pool.loadedSlots();
+  if (handle.index >= slots.size()) {
+    return false;
   }
+  const EntityPool::SlotState &slot = slots[handle.index];
+  return slot.active != 0 && slot.generation == handle.generation &&
+         slot.tag == tag;
 }
 
-void EntityManager::removeDeadEntities(EntityVec &vec) {
-  // Remove all dead entities from the input vector
-  //       this is called by the update() function
-  std::vector<size_t> entityIds;
-  for (auto &entity : vec) {
-    if (!entity->isActive()) {
-      entityIds.push_back(entity->id());
+void EntityManager::finishLoad() {
+  m_totalEntities = static_cast<size_t>(m_loading.totalEntities);
+  m_entitiesToAdd.clear();
+  for (auto &buffer : m_commandBuffers) {
+    buffer.clear();
+  }
+  m_pool.finishLoad();
+  m_entities.clear();
+  for (uint32_t index : m_loading.entities) {
+    m_entities.push_back(&m_pool.at(index));
+  }
+  for (size_t tag = 0; tag < m_entityMap.size(); ++tag) {
+    EntityVec &entities = m_entityMap[tag];
+    entities.clear();
+    for (uint32_t index : m_loading.tagged[tag]) {
+      entities.push_back(&m_pool.at(index));
     }
   }
-  auto filteredList = std::remove_if(vec.begin(), vec.end(),
-                                     [](const std::shared_ptr<Entity> &entity) {
-                                       return !entity->isActive();
-                                     });
-  vec.erase(filteredList, vec.end());
+  std::swap(m_transforms, m_loading.transforms);
+  std::swap(m_shapes, m_loading.shapes);
+  std::swap(m_collisions, m_loading.collisions);
+  std::swap(m_inputs, m_loading.inputs);
+  std::swap(m_scores, m_loading.scores);
+  std::swap(m_lifespans, m_loading.lifespans);
+
+  // the wheel is not saved, the lifespans say when each entity dies
+  m_expiries.clear(m_loading.lifespanTick);
+  const std::vector<uint32_t> &owners = m_lifespans.entities();
+  const std::vector<CLifespan> &lifespans = m_lifespans.data();
+  for (size_t i = 0; i < owners.size(); ++i) {
+    m_expiries.schedule(m_pool.at(owners[i]).handle(),
+                        lifespans[i].start + lifespans[i].total);
+  }
+}
+
+void EntityManager::releaseEntity(Entity &entity) {
+  uint32_t index = entity.m_index;
+  m_transforms.remove(index);
+  m_shapes.remove(index);
+  m_collisions.remove(index);
+  m_inputs.remove(index);
+  m_scores.remove(index);
+  m_lifespans.remove(index);
+  m_pool.release(entity);
+}
+
+void EntityManager::setLimit(size_t limit) { m_limit = limit; }
+
+size_t EntityManager::room() const {
+  if (m_limit == 0) {
+    return SIZE_MAX;
+  }
+  // the dead still count until update() removes them
+  size_t count = m_entities.size() + m_entitiesToAdd.size();
+  for (const CommandBuffer &buffer : m_commandBuffers) {
+    count += buffer.created();
+  }
+  return count < m_limit ? m_limit - count : 0;
 }
 
-std::shared_ptr<Entity> EntityManager::addEntity(const std::string &tag) {
-  auto entity = std::shared_ptr<Entity>(new Entity(m_totalEntities++, tag));
+Entity *EntityManager::addEntity(TagId tag) {
+  Entity *entity = m_pool.create(m_totalEntities++, tag);
 
   m_entitiesToAdd.push_back(entity);
 
@@ -50,6 +450,32 @@ std::shared_ptr<Entity> EntityManager::addEntity(const std::string &tag) {
 
 const EntityVec &EntityManager::getEntities() { return m_entities; }
 
-const EntityVec &EntityManager::getEntities(const std::string &tag) {
+Entity *EntityManager::addEntity(const std::string &tag) {
+  return addEntity(tagId(tag));
+}
+
+const EntityVec &EntityManager::getEntities(TagId tag) {
   return m_entityMap[tag];
 }
+
+const EntityVec &EntityManager::getEntities(const std::string &tag) {
+  return m_entityMap[tagId(tag)];
+}
+
+Entity &EntityManager::getEntity(uint32_t index) { return m_pool.at(index); }
+
+Entity *EntityManager::getEntity(EntityHandle handle) {
+  return m_pool.get(handle);
+}
+
+TagId EntityManager::tagId(const std::string &name) {
+  TagId tag = m_tags.intern(name);
+  if (tag >= m_entityMap.size()) {
+    m_entityMap.resize(m_tags.size());
+  }
+  return tag;
+}
+
+const std::string &EntityManager::tagName(TagId tag) const {
+  return m_tags.name(tag);
+}
@@ -0,0 +1,134 @@
+#include "../include/EntityPool.h"
+
+Entity *EntityPool::create(size_t id, TagId tag) {
+  if (m_freeSlots.empty()) {
+    uint32_t index = static_cast<uint32_t>(m_slots.size());
+    m_slots.push_back(Entity(id, index, tag, this));
+    // every slot can die at most once before the queue is drained
+    m_dying.resize(m_slots.size());
+    return &m_slots.back();
+  }
+
+  Entity &entity = m_slots[m_freeSlots.back()];
+  m_freeSlots.pop_back();
+  entity.m_active = true;
+  entity.m_id = id;
+  entity.m_tag = tag;
+  return &entity;
+}
+
+void EntityPool::reserve(size_t count) {
+  if (count <= m_slots.size()) {
+    return;
+  }
+  uint32_t first = static_cast<uint32_t>(m_slots.size());
+  uint32_t last = static_cast<uint32_t>(count);
+  m_freeSlots.reserve(m_freeSlots.size() + (last - first));
+  // a load swaps the free lists, both need the room
+  m_loadedFreeSlots.reserve(m_freeSlots.capacity());
+  m_marks.reserve(count);
+  // the free list is popped from the back, push the highest index first
+  for (uint32_t index = first; index < last; ++index) {
+    m_slots.push_back(Entity(0, index, Tag::Default, this));
+    m_slots.back().m_active = false;
+  }
+  for (uint32_t index = last; index > first; --index) {
+    m_freeSlots.push_back(index - 1);
+  }
+  m_dying.resize(m_slots.size());
+}
+
+void EntityPool::release(Entity &entity) {
+  entity.m_active = false;
+  entity.m_generation++;
+  m_freeSlots.push_back(entity.m_index);
+}
+
+Entity *EntityPool::get(EntityHandle handle) {
+  if (handle.index >= m_slots.size()) {
+    return nullptr;
+  }
+  Entity &entity = m_slots[handle.index];
+  return entity.m_generation == handle.generation ? &entity : nullptr;
+}
+
+Entity &EntityPool::at(uint32_t index) { return m_slots[index]; }
+
+size_t EntityPool::capacity() const { return m_slots.size(); }
+
+void EntityPool::queueDeath(Entity &entity) {
+  m_dying[m_dyingCount.fetch_add(1, std::memory_order_relaxed)] = &entity;
+}
+
+Entity **EntityPool::dying() { return m_dying.data(); }
+
+size_t EntityPool::dyingCount() const {
+  return m_dyingCount.load(std::memory_order_relaxed);
+}
+
+void EntityPool::clearDying() {
+  m_dyingCount.store(0, std::memory_order_relaxed);
+}
+
+void EntityPool::save(SnapshotWriter &writer) {
+  m_slotStates.clear();
+  for (const Entity &entity : m_slots) {
+    SlotState slot = {};
+    slot.id = entity.m_id;
+    slot.generation = entity.m_generation;
+    slot.allIndex = entity.m_allIndex;
+    slot.tagIndex = entity.m_tagIndex;
+    slot.tag = entity.m_tag;
+    slot.active = entity.m_active;
+    m_slotStates.push_back(slot);
+  }
+  writer.writeArray(m_slotStates);
+  writer.writeArray(m_freeSlots);
+}
+
+bool EntityPool::prepareLoad(SnapshotReader &reader) {
+  if (!reader.readArray(m_slotStates) ||
+      !reader.readArray(m_loadedFreeSlots)) {
+    return false;
+  }
+  // every free slot is dead and listed once, or create() would hand out a
+  // live entity or the same slot twice
+  m_marks.assign(m_slotStates.size(), 0);
+  for (uint32_t index : m_loadedFreeSlots) {
+    if (index >= m_slotStates.size() || m_slotStates[index].active != 0 ||
+        m_marks[index] != 0) {
+      return false;
+    }
+    m_marks[index] = 1;
+  }
+  return true;
+}
+
+const std::vector<EntityPool::SlotState> &EntityPool::loadedSlots() const {
+  return m_slotStates;
+}
+
+void EntityPool::finishLoad() {
+  // the deque keeps the addresses of the slots that stay
+  size_t count = m_slotStates.size();
+  while (m_slots.size() > count) {
+    m_slots.pop_back();
+  }
+  while (m_slots.size() < count) {
+    uint32_t index = static_cast<uint32_t>(m_slots.size());
+    m_slots.push_back(Entity(0, index, Tag::Default, this));
+  }
+  for (Entity &entity : m_slots) {
+    const SlotState &slot = m_slotStates[entity.m_index];
+    entity.m_id = static_cast<size_t>(slot.id);
+    entity.m_generation = slot.generation;
+    entity.m_allIndex = slot.allIndex;
+    entity.m_tagIndex = slot.tagIndex;
+    entity.m_tag = slot.tag;
+    entity.m_active = slot.active != 0;
+  }
+  m_dying.resize(m_slots.size());
+  clearDying();
+  // the old free list keeps its capacity for the next load
+  m_freeSlots.swap(m_loadedFreeSlots);
+}
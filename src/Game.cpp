@@ -1,94 +1,617 @@
 #include "../include/Game.h"
+#include "../include/AllocCounter.h"
+#include "../include/SimdKernels.h"
 
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Keyboard.hpp>
 #include <SFML/Window/Mouse.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <math.h>
 #include <memory>
 #include <string>
 
-Game::Game(const std::string &config) { init(config); }
+// the expected population, or the entity cap when that is higher: the
+// population stays within it, plus the player respawning while the one that
+// died still counts
+static size_t entityCapacity(const GameConfig &config) {
+  size_t capacity = static_cast<size_t>(config.entityCapacity);
+  if (config.wave.C > 0) {
+    capacity = std::max(capacity, static_cast<size_t>(config.wave.C) + 1);
+  }
+  return capacity;
+}
+
+Game::Game(const std::string &config, bool headless) : m_headless(headless) {
+  init(config);
+}
+
+Game::~Game() { stopRenderThread(); }
 
 void Game::init(const std::string &path) {
   // set seeds for rundomizer function
-  srand(time(0));
-
-  // Reading data in config file here
-  //       using the premade PlayerConfig, EnemyConfig, BulletConfig variables
-  //       to store config data
-  std::ifstream fileInput(path);
-  if (!fileInput.is_open()) {
-    std::cerr << "Could not open config file: " << path << std::endl;
+  setSeed(time(0));
+
+  // Reading data in config file here, either the text format or a compiled
+  // one. Every field is checked, a bad config stops the game with the line
+  // and field at fault
+  GameConfig config;
+  ConfigError error;
+  if (!loadConfig(path, config, error)) {
+    std::cerr << "Invalid config: " << error.str() << std::endl;
     exit(1);
   }
-  std::string configName;
-  int windowWidth;
-  int windowHeight;
-  int frameLimit;
-  int screenMode;
-
-  while (fileInput >> configName) {
-    if (configName == "Window") {
-      fileInput >> windowWidth >> windowHeight >> frameLimit >> screenMode;
-    } else if (configName == "Player") {
-      fileInput >> m_playerConfig.SR >> m_playerConfig.CR >> m_playerConfig.S >>
-          m_playerConfig.FR >> m_playerConfig.FG >> m_playerConfig.FB >>
-          m_playerConfig.OR >> m_playerConfig.OG >> m_playerConfig.OB >>
-          m_playerConfig.OT >> m_playerConfig.V;
-
-    } else if (configName == "Enemy") {
-      fileInput >> m_enemyConfig.SR >> m_enemyConfig.CR >> m_enemyConfig.SMIN >>
-          m_enemyConfig.SMAX >> m_enemyConfig.OR >> m_enemyConfig.OG >>
-          m_enemyConfig.OB >> m_enemyConfig.OT >> m_enemyConfig.VMIN >>
-          m_enemyConfig.VMAX >> m_enemyConfig.L >> m_enemyConfig.SI;
-    } else if (configName == "Bullet") {
-      fileInput >> m_bulletConfig.SR >> m_bulletConfig.CR >> m_bulletConfig.S >>
-          m_bulletConfig.FR >> m_bulletConfig.FG >> m_bulletConfig.FB >>
-          m_bulletConfig.OR >> m_bulletConfig.OG >> m_bulletConfig.OB >>
-          m_bulletConfig.OT >> m_bulletConfig.V >> m_bulletConfig.L;
-    } else if (configName == "Font") {
-      std::string fontPath;
-      int fontSize;
-      sf::Color fontColor;
-      fileInput >> fontPath >> fontSize >> fontColor.r >> fontColor.g >>
-          fontColor.b;
-      if (!m_font.loadFromFile(fontPath)) {
-        throw std::invalid_argument("Font not loaded");
-      }
-      m_text.setFont(m_font);
-      m_text.setCharacterSize(fontSize);
-      m_text.setFillColor(fontColor);
+
+  // the world defaults to the window size unless a World line overrides it
+  int worldWidth = config.worldWidth;
+  int worldHeight = config.worldHeight;
+  if (worldWidth <= 0 || worldHeight <= 0) {
+    worldWidth = config.windowWidth;
+    worldHeight = config.windowHeight;
+  }
+  m_worldSize = Vec2(worldWidth, worldHeight);
+
+  // storage for the expected population is allocated up front, so frames
+  // below it do not touch the heap
+  size_t capacity = entityCapacity(config);
+  reserveEntities(capacity);
+
+  // per-entity systems are split across these threads once a loop has more
+  // than minChunkSize entities
+  m_threadPool.start(config.threadCount, config.minChunkSize);
+  m_entities.setThreadCount(m_threadPool.threadCount());
+  m_collisionGrid.setThreadCount(m_threadPool.threadCount());
+
+  // what the systems read of every entity without checking, a snapshot
+  // that lacks it is not loaded
+  const uint8_t drawn = EntityManager::Transform | EntityManager::Shape;
+  const uint8_t collides = drawn | EntityManager::Collision;
+  m_entities.requireComponents(Tag::Default, drawn);
+  m_entities.requireComponents(Tag::Player, collides | EntityManager::Input);
+  m_entities.requireComponents(Tag::Enemy, collides);
+  m_entities.requireComponents(Tag::SmallEnemy, collides);
+  m_entities.requireComponents(Tag::Bullet, collides);
+
+  // particles are only drawn and rewinding needs a player, a headless game
+  // has neither
+  if (!m_headless) {
+    m_particles.reset(config.particleCapacity);
+    int tickRate = config.tickRate > 0 ? config.tickRate
+                   : config.frameLimit > 0 ? config.frameLimit
+                                           : 60;
+    m_rewind.reset(static_cast<size_t>(config.rewindSeconds) * tickRate);
+    m_useRenderThread = config.renderThread != 0;
+    m_renderQueue.reserve(capacity,
+                          static_cast<size_t>(config.particleCapacity) * 4);
+  }
+
+  if (config.fontPath[0] != '\0') {
+    if (!m_font.loadFromFile(config.fontPath)) {
+      throw std::invalid_argument("Font not loaded");
     }
+    m_text.setFont(m_font);
+    m_profilerText.setFont(m_font);
   }
 
   // set up default window parameters
-  m_window.create(sf::VideoMode(windowWidth, windowHeight), "Assignment 2");
-  m_window.setFramerateLimit(frameLimit);
+  if (!m_headless) {
+    m_window.create(sf::VideoMode(config.windowWidth, config.windowHeight),
+                    "Assignment 2");
+  }
 
+  m_startConfig = config;
+  applyConfig(config);
   spawnPlayer();
+
+  // balance changes are picked up while the game runs
+  if (!m_headless && m_configWatcher.start(path)) {
+    std::cout << "Watching " << path << " for changes" << std::endl;
+  }
+}
+
+void Game::reserveEntities(size_t capacity) {
+  if (capacity <= m_entityCapacity) {
+    return;
+  }
+  m_entityCapacity = capacity;
+  m_entities.reserve(capacity);
+  m_collisionGrid.reserve(capacity);
+  m_motions.reserve(capacity);
+  m_renderPositions.reserve(capacity);
+  m_drawnEntities.reserve(capacity);
+  m_collisionEvents.reserve(capacity + 1);
+}
+
+// the settings that are only read when the game starts, by their config
+// line, that differ between the running config and a reloaded one
+static std::string restartChanges(const GameConfig &running,
+                                  const GameConfig &config) {
+  std::string changed;
+  auto check = [&changed](bool differs, const char *name) {
+    if (differs) {
+      changed += changed.empty() ? "" : ", ";
+      changed += name;
+    }
+  };
+  check(config.windowWidth != running.windowWidth ||
+            config.windowHeight != running.windowHeight,
+        "Window size");
+  check(config.worldWidth != running.worldWidth ||
+            config.worldHeight != running.worldHeight,
+        "World");
+  check(config.threadCount != running.threadCount ||
+            config.minChunkSize != running.minChunkSize,
+        "Threads");
+  check(config.rewindSeconds != running.rewindSeconds, "Rewind");
+  check(config.renderThread != running.renderThread, "RenderThread");
+  check(config.particleCapacity != running.particleCapacity, "Particles N");
+  check(std::strcmp(config.fontPath, running.fontPath) != 0, "Font file");
+  return changed;
+}
+
+void Game::applyConfig(const GameConfig &config) {
+  // the rest is kept as the game started, a reload that changes it says so
+  std::string changed = restartChanges(m_startConfig, config);
+  if (!changed.empty()) {
+    std::cerr << "Config changes that need a restart: " << changed
+              << std::endl;
+  }
+  // the player velocity is stored scaled by its speed, rescale it
+  if (Entity *entity = player()) {
+    TransformPool::Ref transform = m_entities.transforms().get(entity->index());
+    if (m_playerConfig.S != 0) {
+      transform.velocity =
+          transform.velocity / m_playerConfig.S * config.player.S;
+    }
+  }
+  m_playerConfig = config.player;
+  m_enemyConfig = config.enemy;
+  m_bulletConfig = config.bullet;
+  m_waveConfig = config.wave;
+  // a reload that raises the cap or the capacity grows the storage now,
+  // between two frames, rather than inside one. The render frames grow on
+  // their own the first time they need to.
+  m_entities.setLimit(static_cast<size_t>(config.wave.C));
+  reserveEntities(entityCapacity(config));
+  m_entities.setStableOrder(config.stableOrder != 0);
+  m_particlesPerKill = config.particlesPerKill;
+  m_particleLifetime = config.particleLifetime;
+  m_particleSpeed = config.particleSpeed;
+  m_renderStyle.lodOutline = config.lodOutline;
+  m_renderStyle.lodPolygon = config.lodPolygon;
+  m_renderStyle.lodPoints = config.lodPoints;
+
+  // the simulation ticks at the frame limit unless a Simulation line sets its
+  // own rate, velocities, lifespans and spawn intervals are all per tick
+  int tickRate = config.tickRate;
+  if (tickRate <= 0) {
+    tickRate = config.frameLimit > 0 ? config.frameLimit : 60;
+  }
+  m_tickSeconds = 1.0f / tickRate;
+  m_maxTicksPerFrame = config.maxTicksPerFrame;
+  m_frameLimit = config.frameLimit;
+  m_lowLatency = config.lowLatency != 0;
+  // the window and the texts belong to the renderer, it applies these with
+  // the next frame. In the low latency mode the loop waits for the next
+  // frame before it reads the input, instead of display() waiting after the
+  // frame is drawn.
+  m_renderStyle.frameLimit = m_lowLatency ? 0 : config.frameLimit;
+  m_renderStyle.fontSize = config.fontSize;
+  m_renderStyle.fontColor = sf::Color(config.fontR, config.fontG, config.fontB);
+
+  // grid cells hold at least one enemy diameter so a query touches few cells
+  float maxCollisionRadius = std::max(
+      {m_enemyConfig.CR, m_playerConfig.CR, m_bulletConfig.CR});
+  m_collisionGrid.reset(m_worldSize, 2.0f * maxCollisionRadius);
+
+  // entities already in the world take the new shape settings, bullets and
+  // small enemies only live for a lifespan and pick them up when respawned
+  if (Entity *entity = player()) {
+    CShape &shape = m_entities.shapes().get(entity->index());
+    shape.radius = m_playerConfig.SR;
+    shape.points = m_playerConfig.V;
+    shape.fill =
+        sf::Color(m_playerConfig.FR, m_playerConfig.FG, m_playerConfig.FB);
+    shape.outline =
+        sf::Color(m_playerConfig.OR, m_playerConfig.OG, m_playerConfig.OB);
+    shape.thickness = m_playerConfig.OT;
+    m_entities.collisions().get(entity->index()).radius = m_playerConfig.CR;
+  }
+  for (Entity *entity : m_entities.getEntities(Tag::Enemy)) {
+    CShape &shape = m_entities.shapes().get(entity->index());
+    shape.radius = m_enemyConfig.SR;
+    shape.outline =
+        sf::Color(m_enemyConfig.OR, m_enemyConfig.OG, m_enemyConfig.OB);
+    shape.thickness = m_enemyConfig.OT;
+    m_entities.collisions().get(entity->index()).radius = m_enemyConfig.CR;
+  }
 }
 
 void Game::run() {
+  // fixed timestep: the frame time is added to an accumulator and the
+  // simulation runs as many whole ticks as it holds, so the game speed does
+  // not depend on the frame rate. The rest of the accumulator is how far the
+  // frame is into the next tick and the renderer interpolates by it.
+  sf::Clock clock;
+  float accumulator = 0;
+  // With the render thread a frame is drawn while the next one is
+  // simulated. Its input is polled as late as possible: the loop waits until
+  // the render thread is about to need a frame, less the time it takes to
+  // make one, so input does not reach the screen later than when the loop
+  // drew the frames itself.
+  // The Latency mode goes further: the loop paces itself before it reads the
+  // input, shots fired are added to the world right away and the newest tick
+  // is drawn as it is instead of interpolated towards from the one before.
+  // Every frame that shows new input records how long it took to get to
+  // display().
+  startRenderThread();
+  RenderQueue::Clock::duration lead(0); // poll to publish, averaged
+  RenderQueue::Clock::time_point frameStart = RenderQueue::Clock::now();
   while (m_running) {
-    m_entities.update();
+    if (m_renderThread.joinable()) {
+      waitForRenderSlot(lead + std::chrono::microseconds(500));
+    }
+    if (m_lowLatency) {
+      waitForFrameSlot(frameStart);
+    }
+    frameStart = RenderQueue::Clock::now();
+    size_t allocationsBefore = allocationCount();
+    m_profiler.beginFrame();
+    GameConfig reloaded;
+    if (m_configWatcher.poll(reloaded)) {
+      applyConfig(reloaded);
+      std::cout << "Config reloaded" << std::endl;
+    }
+    float frameSeconds = clock.restart().asSeconds();
+    accumulator += frameSeconds;
+
+    {
+      Profiler::Scope scope(m_profiler, Zone::UserInput);
+      sUserInput();
+    }
+    if (m_lowLatency) {
+      Profiler::Scope scope(m_profiler, Zone::Update);
+      m_entities.update();
+    }
+
+    int ticks = 0;
+    while (accumulator >= m_tickSeconds && ticks < m_maxTicksPerFrame) {
+      {
+        Profiler::Scope scope(m_profiler, Zone::Update);
+        m_entities.update();
+      }
+      // every running tick is recorded, holding backspace steps back
+      // through them one per tick instead of simulating
+      if (m_rewind.capacity() > 0 && (m_rewinding || !m_paused)) {
+        Profiler::Scope scope(m_profiler, Zone::Rewind);
+        int frame = 0;
+        if (!m_rewinding) {
+          saveState(m_snapshot);
+          m_rewind.push(m_currentFrame, m_snapshot);
+        } else if (m_rewind.pop(frame, m_snapshot)) {
+          loadState(m_snapshot);
+        }
+      }
+      if (!m_rewinding) {
+        simulate();
+      }
+      accumulator -= m_tickSeconds;
+      ticks++;
+    }
+    // after a long stall drop the time we could not catch up on, otherwise
+    // every following frame would run the maximum number of ticks
+    if (ticks == m_maxTicksPerFrame) {
+      accumulator = std::min(accumulator, m_tickSeconds);
+    }
+
+    // the input read so far is on screen with the first frame drawn after a
+    // tick ran on it
+    if (ticks > 0 && m_inputPolled != RenderQueue::Clock::time_point()) {
+      m_shownInputPolled = m_inputPolled;
+      m_shownInputPreviousPoll = m_inputPreviousPoll;
+      m_inputPolled = RenderQueue::Clock::time_point();
+    }
+
+    // nothing moves while paused, so draw the current positions as they are
+    float alpha =
+        m_paused || m_lowLatency ? 1.0f : accumulator / m_tickSeconds;
+    {
+      Profiler::Scope scope(m_profiler, Zone::Render);
+      sRender(alpha, frameSeconds / m_tickSeconds);
+    }
+    lead += (RenderQueue::Clock::now() - frameStart - lead) / 8;
+    m_profiler.endFrame();
+    m_frameAllocations = allocationCount() - allocationsBefore;
+  }
+  stopRenderThread();
+  std::string latency = latencySummary();
+  if (!latency.empty()) {
+    std::cout << latency << std::endl;
+  }
+  if (m_traceOnExit) {
+    writeTrace();
+  }
+}
+
+namespace {
+// frame times from one wave to the next, the population level of a wave
+struct WaveSample {
+  int wave = -1;
+  size_t spawned = 0;
+  size_t entities = 0;
+  int frames = 0;
+  double totalMs = 0;
+  double maxMs = 0;
+};
+} // namespace
+
+int Game::runHeadless(int frames) {
+  sf::Clock clock;
+  int frame = 0;
+  int allocatingFrames = 0;
+  size_t maxFrameAllocations = 0;
+  // one sample per wave, reserved so the allocation check still holds
+  std::vector<WaveSample> waves;
+  WaveSample wave;
+  if (m_waveConfig.K > 0) {
+    waves.reserve(static_cast<size_t>(frames / m_waveConfig.I + 2));
+  }
+  for (; frame < frames && m_running; ++frame) {
+    size_t allocationsBefore = allocationCount();
+    sf::Clock frameClock;
+    m_profiler.beginFrame();
+    // stands in for the mouse, so bullets and small enemies are exercised
+    if (m_autofireInterval > 0 && frame % m_autofireInterval == 0) {
+      spawnSpecialWeapon(player());
+    }
+    {
+      Profiler::Scope scope(m_profiler, Zone::Update);
+      m_entities.update();
+    }
+    simulate();
+    m_profiler.endFrame();
+
+    if (m_waveConfig.K > 0) {
+      if (m_wave - 1 != wave.wave) {
+        if (wave.wave >= 0) {
+          waves.push_back(wave);
+        }
+        wave = WaveSample();
+        wave.wave = m_wave - 1;
+        wave.spawned = m_waveSpawned;
+      }
+      double ms = frameClock.getElapsedTime().asMicroseconds() / 1000.0;
+      wave.frames++;
+      wave.totalMs += ms;
+      wave.maxMs = std::max(wave.maxMs, ms);
+      wave.entities = m_entities.getEntities().size();
+    }
+
+    m_frameAllocations = allocationCount() - allocationsBefore;
+    if (m_allocationCheckWarmup >= 0 && frame >= m_allocationCheckWarmup &&
+        m_frameAllocations > 0) {
+      allocatingFrames++;
+      maxFrameAllocations = std::max(maxFrameAllocations, m_frameAllocations);
+    }
+  }
+  // flush the entities spawned during the last frame before counting
+  m_entities.update();
+  float seconds = clock.getElapsedTime().asSeconds();
+
+  std::cout << "frames: " << frame << "\n";
+  std::cout << "seconds: " << seconds << "\n";
+  std::cout << "fps: " << (seconds > 0.0f ? frame / seconds : 0.0f) << "\n";
+  std::cout << "entities: " << m_entities.getEntities().size() << "\n";
+  for (TagId tag : {Tag::Player, Tag::Enemy, Tag::SmallEnemy, Tag::Bullet}) {
+    std::cout << m_entities.tagName(tag) << ": "
+              << m_entities.getEntities(tag).size() << "\n";
+  }
+  std::cout << "score: " << m_score << "\n";
+  std::cout << "threads: " << m_threadPool.threadCount() << "\n";
+  std::cout << "checksum: " << std::hex << worldChecksum() << std::dec
+            << std::endl;
+  if (m_profiler.enabled()) {
+    for (uint8_t zone = 0; zone < Zone::Count; ++zone) {
+      if (zone == Zone::UserInput || zone == Zone::Rewind ||
+          zone == Zone::Render) {
+        continue;
+      }
+      std::cout << "zone " << Profiler::zoneName(zone)
+                << ": avg_ms=" << m_profiler.average(zone)
+                << " p99_ms=" << m_profiler.percentile(zone, 0.99) << "\n";
+    }
+  }
+  if (wave.wave >= 0) {
+    waves.push_back(wave);
+  }
+  for (const WaveSample &sample : waves) {
+    std::cout << "wave " << sample.wave << ": entities=" << sample.entities
+              << " spawned=" << sample.spawned << " frames=" << sample.frames
+              << " avg_frame_ms=" << sample.totalMs / sample.frames
+              << " max_frame_ms=" << sample.maxMs << "\n";
+  }
+  if (m_traceOnExit) {
+    writeTrace();
+  }
 
-    sUserInput();
-    sRender();
-    if (!m_paused) {
+  if (m_allocationCheckWarmup < 0) {
+    return 0;
+  }
+  std::cout << "allocating_frames: " << allocatingFrames << "\n";
+  std::cout << "max_frame_allocations: " << maxFrameAllocations << "\n";
+  if (allocatingFrames > 0) {
+    std::cout << "allocation check: FAILED, frames after the first "
+              << m_allocationCheckWarmup << " allocated" << std::endl;
+    return 1;
+  }
+  std::cout << "allocation check: passed" << std::endl;
+  return 0;
+}
+
+void Game::setAutofire(int frames) { m_autofireInterval = frames; }
+
+void Game::checkAllocations(int warmupFrames) {
+  m_allocationCheckWarmup = std::max(warmupFrames, 0);
+}
+
+void Game::enableTrace(const std::string &path) {
+  m_tracePath = path;
+  m_traceOnExit = true;
+  m_profiler.setEnabled(true);
+}
+
+void Game::writeTrace() {
+  if (m_profiler.writeTrace(m_tracePath)) {
+    std::cout << "trace: " << m_tracePath << " (" << m_profiler.frames()
+              << " frames)" << std::endl;
+  } else {
+    std::cerr << "Could not write trace file: " << m_tracePath << std::endl;
+  }
+}
+
+uint64_t Game::worldChecksum() {
+  // FNV-1a over the raw bits of every transform, equal runs give equal sums
+  auto &transforms = m_entities.transforms();
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+  };
+  mix(transforms.positions.data(), transforms.positions.size() * sizeof(Vec2));
+  mix(transforms.velocities.data(),
+      transforms.velocities.size() * sizeof(Vec2));
+  mix(transforms.angles.data(), transforms.angles.size() * sizeof(float));
+  return hash;
+}
+
+void Game::setSeed(unsigned int seed) {
+  // spread small seeds over the state, xorshift must not start at zero
+  m_random = seed * 2654435761u + 0x9e3779b9u;
+  if (m_random == 0) {
+    m_random = 1;
+  }
+}
+
+uint32_t Game::nextRandom() {
+  m_random ^= m_random << 13;
+  m_random ^= m_random >> 17;
+  m_random ^= m_random << 5;
+  return m_random;
+}
+
+// game state that is not in the entity manager, laid out as one record
+struct GameState {
+  int score;
+  int currentFrame;
+  int lastEnemySpawnTime;
+  int wave;
+  uint32_t random;
+  EntityHandle player;
+};
+
+void Game::saveState(std::vector<char> &data) {
+  // nothing may be pending while the entity manager is saved
+  m_entities.update();
+  SnapshotWriter writer(data);
+  writer.write(Snapshot::magic);
+  writer.write(Snapshot::version);
+  writer.write(static_cast<uint32_t>(sizeof(GameState)));
+  GameState state = {m_score,  m_currentFrame, m_lastEnemySpawnTime,
+                     m_wave,   m_random,       m_player};
+  writer.write(state);
+  m_entities.save(writer);
+  writer.finish();
+}
+
+bool Game::loadState(const std::vector<char> &data) {
+  SnapshotReader reader(data.data(), data.size());
+  char magic[4];
+  uint32_t version = 0;
+  uint32_t stateSize = 0;
+  GameState state;
+  if (!reader.read(magic) ||
+      std::memcmp(magic, Snapshot::magic, sizeof(magic)) != 0 ||
+      !reader.read(version) || version != Snapshot::version ||
+      !reader.read(stateSize) || stateSize != sizeof(GameState) ||
+      !reader.read(state)) {
+    return false;
+  }
+  // nothing changes until the whole snapshot checked out
+  if (!m_entities.prepareLoad(reader) ||
+      !m_entities.loadedEntity(state.player, Tag::Player)) {
+    return false;
+  }
+  m_entities.finishLoad();
+  m_score = state.score;
+  m_currentFrame = state.currentFrame;
+  m_lastEnemySpawnTime = state.lastEnemySpawnTime;
+  m_wave = state.wave;
+  m_random = state.random;
+  m_player = state.player;
+  return true;
+}
+
+bool Game::saveSnapshot(const std::string &path) {
+  saveState(m_snapshot);
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  output.write(m_snapshot.data(), m_snapshot.size());
+  if (!output) {
+    std::cerr << "Could not write snapshot " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool Game::loadSnapshot(const std::string &path) {
+  std::ifstream input(path, std::ios::binary);
+  if (!input.is_open()) {
+    std::cerr << "Could not open snapshot " << path << std::endl;
+    return false;
+  }
+  m_snapshot.assign(std::istreambuf_iterator<char>(input),
+                    std::istreambuf_iterator<char>());
+  if (!loadState(m_snapshot)) {
+    std::cerr << "Not a valid snapshot of this build, not loaded: " << path
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Game::simulate() {
+  if (!m_paused) {
+    {
+      Profiler::Scope scope(m_profiler, Zone::Movement);
       sMovement();
+    }
+    {
+      Profiler::Scope scope(m_profiler, Zone::Lifespan);
       sLifespan();
+    }
+    {
+      Profiler::Scope scope(m_profiler, Zone::EnemySpawner);
       sEnemySpawner();
+    }
+    {
+      Profiler::Scope scope(m_profiler, Zone::Collision);
       sCollision();
     }
-    // increment the current frame
-    // may need to be moved when pause implemented
-    m_currentFrame++;
+    {
+      Profiler::Scope scope(m_profiler, Zone::Particles);
+      sParticles();
+    }
   }
+  // increment the current frame
+  // may need to be moved when pause implemented
+  m_currentFrame++;
 }
 
 void Game::setPaused(bool paused) { m_paused = paused; }
@@ -96,65 +619,75 @@ void Game::setPaused(bool paused) { m_paused = paused; }
 // respawn the player in the middle of the screen
 void Game::spawnPlayer() {
   // We create every entity by calling EntityManager.addEntity(tag)
-  // This returns a std::shared_ptr<Entity>, so we use 'auto' to save typing
-  auto entity = m_entities.addEntity("player");
+  // This returns a pointer into the entity pool, so we use 'auto' to save
+  // typing
+  // Components are added to the EntityManager pools under the entity index
+  // The player is spawned past the entity cap, the game needs one
+  auto entity = m_entities.addEntity(Tag::Player);
+  uint32_t index = entity->index();
 
   // Give this entity a Transform so it spawns at center of window with velocity
   // (0, 0) and angle 0
-  Vec2 playerPosition;
-  sf::Vector2u windowSize = m_window.getSize();
-  playerPosition = Vec2(windowSize.x, windowSize.y) / 2;
-  entity->cTransform =
-      std::make_shared<CTransform>(playerPosition, Vec2(0.0f, 0.0f), 0.0f);
+  Vec2 playerPosition = m_worldSize / 2;
+  m_entities.transforms().add(
+      index, CTransform(playerPosition, Vec2(0.0f, 0.0f), 0.0f));
 
   // The entity's shape will have radius X, X sides, COLOR-X fill, and COLOR-X
   // outline of thickness X (X is number from config structure PlayerConfig)
-  entity->cShape = std::make_shared<CShape>(
-      m_playerConfig.SR, m_playerConfig.V,
+  m_entities.shapes().add(
+      index, m_playerConfig.SR, m_playerConfig.V,
       sf::Color(m_playerConfig.FR, m_playerConfig.FG, m_playerConfig.FB),
       sf::Color(m_playerConfig.OR, m_playerConfig.OG, m_playerConfig.OB),
       m_playerConfig.OT);
 
   // Add an input component to the player so that we can use inputs
-  entity->cInput = std::make_shared<CInput>();
-  entity->cCollision = std::make_shared<CCollision>(m_playerConfig.CR);
+  m_entities.inputs().add(index);
+  m_entities.collisions().add(index, m_playerConfig.CR);
   // Since we want this entity to be our player, set our Game's player variable
   // to be this Entity This goes slightly against th EntityManager paradigm, but
-  // we use th player so much it's worth it
-  m_player = entity;
+  // we use th player so much it's worth it. We keep a handle rather than the
+  // pointer so a stale player is detected after its slot is reused
+  m_player = entity->handle();
 }
 
+Entity *Game::player() { return m_entities.getEntity(m_player); }
+
 // spawn an enemy at a random position
 void Game::spawnEnemy() {
   // Spawne enemy properly with the m_enemyConfig variables
   //       the enemy spawned completely within the bounds of the window
+  if (m_entities.room() == 0) {
+    return;
+  }
 
-  auto entity = m_entities.addEntity("enemy");
+  auto entity = m_entities.addEntity(Tag::Enemy);
   // Give this entity a Transform so it spawns at range of window with velocity
   // (0, 0) and angle 0
   Vec2 enemyPosition;
-  sf::Vector2u windowSize = m_window.getSize();
   // x and y range of spawn for enemy
   sf::Vector2u xRangeWindowSpawn =
-      sf::Vector2u(m_enemyConfig.SR, windowSize.x - m_enemyConfig.SR);
+      sf::Vector2u(m_enemyConfig.SR, m_worldSize.x - m_enemyConfig.SR);
   sf::Vector2u yRangeWindowSpawn =
-      sf::Vector2u(m_enemyConfig.SR, windowSize.y - m_enemyConfig.SR);
+      sf::Vector2u(m_enemyConfig.SR, m_worldSize.y - m_enemyConfig.SR);
   int xRundNum = rundomNumber(xRangeWindowSpawn.x, xRangeWindowSpawn.y);
   int yRundNum = rundomNumber(yRangeWindowSpawn.x, yRangeWindowSpawn.y);
   int shapeVerticesRundNum =
       rundomNumber(3, 8); // rundom number of vertices for shape
 
-  entity->cTransform = std::make_shared<CTransform>(Vec2(xRundNum, yRundNum),
-                                                    rundomVelocity(), 1.0f);
-  entity->cCollision = std::make_shared<CCollision>(m_enemyConfig.CR);
-  entity->cShape = std::make_shared<CShape>(
-      m_enemyConfig.SR, shapeVerticesRundNum, sf::Color(rundomColor()),
+  uint32_t index = entity->index();
+  // enemies are bounded, they bounce off the edges of the world
+  m_entities.transforms().add(
+      index, CTransform(Vec2(xRundNum, yRundNum), rundomVelocity(), 1.0f),
+      true);
+  m_entities.collisions().add(index, m_enemyConfig.CR);
+  m_entities.shapes().add(
+      index, m_enemyConfig.SR, shapeVerticesRundNum, sf::Color(rundomColor()),
       sf::Color(m_enemyConfig.OR, m_enemyConfig.OG, m_enemyConfig.OB),
       m_enemyConfig.OT);
 }
 
 int Game::rundomNumber(int min, int max) {
-  return min + (rand() % (1 + max - min));
+  return min + static_cast<int>(nextRandom() % (1 + max - min));
 }
 
 sf::Color Game::rundomColor() {
@@ -166,100 +699,126 @@ sf::Color Game::rundomColor() {
 }
 
 Vec2 Game::rundomVelocity() {
-  int xValue = rand() % 2 == 0 ? -1 : 1;
-  int yValue = rand() % 2 == 0 ? -1 : 1;
+  int xValue = nextRandom() % 2 == 0 ? -1 : 1;
+  int yValue = nextRandom() % 2 == 0 ? -1 : 1;
   return Vec2(xValue, yValue);
 }
 
-// spawns the small enemies when a big one (input entity e) explodes
-void Game::spawnSmallEnemies(std::shared_ptr<Entity> e) {
+// the command buffer of the calling thread, main or pool worker
+CommandBuffer &Game::commands() {
+  return m_entities.commands(ThreadPool::threadIndex());
+}
+
+// spawns the small enemies when a big one (input entity e) explodes.
+// Recorded in the command buffer, so it is safe to call from a system running
+// on the thread pool; the small enemies appear at the next entity update. The
+// entity cap is only exact when called on the main thread.
+void Game::spawnSmallEnemies(Entity *e) {
   int movementSpeed = 5; // movement speed of spawned small enemy
-  int shapeVertices = e->cShape->circle.getPointCount();
-  int shapeSize = e->cShape->circle.getRadius() / 2;
-  Vec2 positionEnemey = e->cTransform->pos;
+  const CShape &parentShape = m_entities.shapes().get(e->index());
+  int shapeVertices = parentShape.points;
+  sf::Color fillColor = parentShape.fill;
+  sf::Color outlineColor = parentShape.outline;
+  float outlineThickness = parentShape.thickness;
+  float collisionRadius = m_entities.collisions().get(e->index()).radius;
+  Vec2 positionEnemey = m_entities.transforms().get(e->index()).pos;
   int angleSide = 360 / shapeVertices;
+  // as many as the entity cap leaves room for
+  int count = static_cast<int>(
+      std::min<size_t>(shapeVertices, m_entities.room()));
+  // keyed by the parent, the merge orders the children the same way
+  // whichever thread recorded them
+  CommandBuffer &buffer = commands();
+  buffer.setOrderKey(e->id());
   // creating small enemies process loop
-  for (int i = 1; i <= shapeVertices; ++i) {
+  for (int i = 1; i <= count; ++i) {
     int angleStepRadius = angleSide * i;
     float angleRdaius = angleStepRadius * (M_PI / 180);
     Vec2 targetPoint = Vec2(cos(angleRdaius), sin(angleRdaius));
     Vec2 velocityValue =
         Vec2(targetPoint.x * movementSpeed, targetPoint.y * movementSpeed);
     // creating small enemy
-    auto entity = m_entities.addEntity("smallEnemy");
-    entity->cTransform =
-        std::make_shared<CTransform>(positionEnemey, velocityValue, 0.0f);
-    entity->cShape = std::make_shared<CShape>(
-        m_enemyConfig.SR / 2.0f, shapeVertices,
-        e->cShape->circle.getFillColor(), e->cShape->circle.getOutlineColor(),
-        e->cShape->circle.getOutlineThickness());
-    entity->cLifespan = std::make_shared<CLifespan>(m_enemyConfig.L);
-    entity->cCollision = std::make_shared<CCollision>(e->cCollision->radius);
+    CommandBuffer::Pending entity = buffer.create(Tag::SmallEnemy);
+    buffer.addTransform(entity,
+                        CTransform(positionEnemey, velocityValue, 0.0f));
+    buffer.add(entity, CShape(m_enemyConfig.SR / 2.0f, shapeVertices,
+                              fillColor, outlineColor, outlineThickness));
+    buffer.add(entity, CLifespan(m_enemyConfig.L));
+    buffer.add(entity, CCollision(collisionRadius));
   }
 }
 
 // spawns a bullet from a given entity to a target location
-void Game::spawnBullet(std::shared_ptr<Entity> entity, const Vec2 &target) {
-  auto entityBullet = m_entities.addEntity("bullet");
-  Vec2 bulletPosition = entity->cTransform->pos;
+void Game::spawnBullet(Entity *entity, const Vec2 &target) {
+  Vec2 bulletPosition = m_entities.transforms().get(entity->index()).pos;
   Vec2 bulletNormalize = bulletPosition.normalizeToTarget(target);
+  // a click right on the entity gives no direction to fire in, and a full
+  // world has no room for the bullet
+  if (bulletNormalize == Vec2() || m_entities.room() == 0) {
+    return;
+  }
+  auto entityBullet = m_entities.addEntity(Tag::Bullet);
+  uint32_t index = entityBullet->index();
   Vec2 bulletVelocity = Vec2(bulletNormalize.x * m_bulletConfig.S,
                              bulletNormalize.y * m_bulletConfig.S);
-  entityBullet->cTransform =
-      std::make_shared<CTransform>(bulletPosition, bulletVelocity, 0.0f);
-  entityBullet->cCollision = std::make_shared<CCollision>(m_bulletConfig.CR);
-  entityBullet->cLifespan = std::make_shared<CLifespan>(m_bulletConfig.L);
-  entityBullet->cShape = std::make_shared<CShape>(
-      m_bulletConfig.SR, m_bulletConfig.V, sf::Color::White, sf::Color::Red,
-      m_bulletConfig.OT);
+  m_entities.transforms().add(
+      index, CTransform(bulletPosition, bulletVelocity, 0.0f));
+  m_entities.collisions().add(index, m_bulletConfig.CR);
+  m_entities.addLifespan(index, m_bulletConfig.L);
+  m_entities.shapes().add(index, m_bulletConfig.SR, m_bulletConfig.V,
+                          sf::Color::White, sf::Color::Red,
+                          m_bulletConfig.OT);
 }
 
-void Game::spawnSpecialWeapon(std::shared_ptr<Entity> e) {
+void Game::spawnSpecialWeapon(Entity *e) {
   //  processing of special weapon
   int movementSpeed = m_bulletConfig.S; // movement speed of bullet
-  int shapeVertices = e->cShape->circle.getPointCount();
-  int shapeSize = e->cShape->circle.getRadius() / 2;
-  Vec2 positionPlayer = e->cTransform->pos;
+  // copy what we need from the player, adding to the pools may reallocate them
+  const CShape &playerShape = m_entities.shapes().get(e->index());
+  int shapeVertices = playerShape.points;
+  sf::Color outlineColor = playerShape.outline;
+  float outlineThickness = playerShape.thickness;
+  float collisionRadius = m_entities.collisions().get(e->index()).radius;
+  Vec2 positionPlayer = m_entities.transforms().get(e->index()).pos;
   int angleSide = 360 / shapeVertices;
+  // as many as the entity cap leaves room for
+  int count = static_cast<int>(
+      std::min<size_t>(shapeVertices, m_entities.room()));
   // creating bullets process loop
-  for (int i = 1; i <= shapeVertices; ++i) {
+  for (int i = 1; i <= count; ++i) {
     int angleStepRadius = angleSide * i;
     float angleRdaius = angleStepRadius * (M_PI / 180);
     Vec2 targetPoint = Vec2(cos(angleRdaius), sin(angleRdaius));
     Vec2 velocityValue =
         Vec2(targetPoint.x * movementSpeed, targetPoint.y * movementSpeed);
     // creating bullet
-    auto entity = m_entities.addEntity("bullet");
-    entity->cTransform =
-        std::make_shared<CTransform>(positionPlayer, velocityValue, 0.0f);
-    entity->cShape = std::make_shared<CShape>(
-        m_enemyConfig.SR / 2.0f, shapeVertices, sf::Color::White,
-        e->cShape->circle.getOutlineColor(),
-        e->cShape->circle.getOutlineThickness());
-    entity->cLifespan = std::make_shared<CLifespan>(m_enemyConfig.L);
-    entity->cCollision = std::make_shared<CCollision>(e->cCollision->radius);
+    auto entity = m_entities.addEntity(Tag::Bullet);
+    uint32_t index = entity->index();
+    m_entities.transforms().add(
+        index, CTransform(positionPlayer, velocityValue, 0.0f));
+    m_entities.shapes().add(index, m_enemyConfig.SR / 2.0f, shapeVertices,
+                            sf::Color::White, outlineColor, outlineThickness);
+    m_entities.addLifespan(index, m_enemyConfig.L);
+    m_entities.collisions().add(index, collisionRadius);
   }
 }
 
 void Game::sMovement() {
   // All entity movement implementation in this function
 
-  for (auto &entity : m_entities.getEntities("bullet")) {
-    entity->cTransform->pos.x += entity->cTransform->velocity.x;
-    entity->cTransform->pos.y += entity->cTransform->velocity.y;
-  }
-
-  for (auto &entity : m_entities.getEntities("enemy")) {
-    entity->cTransform->pos.x += entity->cTransform->velocity.x;
-    entity->cTransform->pos.y += entity->cTransform->velocity.y;
-  }
-
-  for (auto &entity : m_entities.getEntities("smallEnemy")) {
-    entity->cTransform->pos.x += entity->cTransform->velocity.x;
-    entity->cTransform->pos.y += entity->cTransform->velocity.y;
-  }
-
+  // the player sets its velocity from the input state first, after that every
+  // transform moves the same way so the loop streams through the pool arrays
   sPlayerInputStateProcess();
+
+  // keep the positions from before this tick for render interpolation
+  auto &transforms = m_entities.transforms();
+  Vec2 *positions = transforms.positions.data();
+  Vec2 *previousPositions = transforms.previousPositions.data();
+  const Vec2 *velocities = transforms.velocities.data();
+  m_threadPool.parallelFor(transforms.size(), [=](size_t begin, size_t end) {
+    std::copy(positions + begin, positions + end, previousPositions + begin);
+    Simd::integrate(positions + begin, velocities + begin, end - begin);
+  });
 }
 
 void Game::sPlayerInputStateProcess() {
@@ -269,211 +828,314 @@ void Game::sPlayerInputStateProcess() {
   }
 
   sf::Vector2u xRangeWindowSpawn =
-      sf::Vector2u(m_playerConfig.SR, m_window.getSize().x - m_playerConfig.SR);
+      sf::Vector2u(m_playerConfig.SR, m_worldSize.x - m_playerConfig.SR);
   sf::Vector2u yRangeWindowSpawn =
-      sf::Vector2u(m_playerConfig.SR, m_window.getSize().y - m_playerConfig.SR);
+      sf::Vector2u(m_playerConfig.SR, m_worldSize.y - m_playerConfig.SR);
 
   Vec2 topLeftLimit = Vec2(m_playerConfig.SR, m_playerConfig.SR);
-  Vec2 bottomRightLimit = Vec2(m_window.getSize().x - m_playerConfig.SR,
-                               m_window.getSize().y - m_playerConfig.SR);
+  Vec2 bottomRightLimit = Vec2(m_worldSize.x - m_playerConfig.SR,
+                               m_worldSize.y - m_playerConfig.SR);
 
-  Vec2 currentPosition = m_player->cTransform->pos;
+  CInput &input = m_entities.inputs().get(player()->index());
+  TransformPool::Ref transform = m_entities.transforms().get(player()->index());
+  Vec2 currentPosition = transform.pos;
 
-  if (m_player->cInput->up || m_player->cInput->down ||
-      m_player->cInput->left || m_player->cInput->right) {
-    if (m_player->cInput->up & !m_player->cInput->down) {
+  // the pool holds the velocity scaled by the player speed, the input logic
+  // below works with the unit direction
+  Vec2 direction;
+  if (m_playerConfig.S != 0) {
+    direction = transform.velocity / m_playerConfig.S;
+  }
+
+  if (input.up || input.down || input.left || input.right) {
+    if (input.up & !input.down) {
       if (currentPosition.y < m_playerConfig.SR) {
         // it's collide with up edge it can't move up
-        m_player->cInput->up = false;
+        input.up = false;
       } else {
-        m_player->cTransform->velocity.y = -1;
+        direction.y = -1;
       }
-      if (m_player->cInput->right) {
-        if (currentPosition.x > m_window.getSize().x - m_playerConfig.SR) {
+      if (input.right) {
+        if (currentPosition.x > m_worldSize.x - m_playerConfig.SR) {
           // it's collide with right edge it can't move right
-          m_player->cInput->right = false;
+          input.right = false;
         } else {
-          m_player->cTransform->velocity.x = 1;
+          direction.x = 1;
         }
-      } else if (m_player->cInput->left) {
+      } else if (input.left) {
         if (currentPosition.x < m_playerConfig.SR) {
           // it's collide with left edge it can't move left
-          m_player->cInput->left = false;
+          input.left = false;
         } else {
-          m_player->cTransform->velocity.x = -1;
+          direction.x = -1;
         }
       } else {
-        m_player->cTransform->velocity.x = 0;
+        direction.x = 0;
       }
-    } else if (m_player->cInput->down & !m_player->cInput->up) {
-      if (currentPosition.y > m_window.getSize().y - m_playerConfig.SR) {
+    } else if (input.down & !input.up) {
+      if (currentPosition.y > m_worldSize.y - m_playerConfig.SR) {
         // it's collide with bottom edge it can't move bottom
-        m_player->cInput->down = false;
+        input.down = false;
       } else {
-        m_player->cTransform->velocity.y = 1;
+        direction.y = 1;
       }
-      if (m_player->cInput->right) {
-        if (currentPosition.x > m_window.getSize().x - m_playerConfig.SR) {
+      if (input.right) {
+        if (currentPosition.x > m_worldSize.x - m_playerConfig.SR) {
           // it's collide with right edge it can't move right
-          m_player->cInput->right = false;
+          input.right = false;
         } else {
-          m_player->cTransform->velocity.x = 1;
+          direction.x = 1;
         }
-      } else if (m_player->cInput->left) {
+      } else if (input.left) {
         if (currentPosition.x < m_playerConfig.SR) {
           // it's collide with left edge it can't move left
-          m_player->cInput->left = false;
+          input.left = false;
         } else {
-          m_player->cTransform->velocity.x = -1;
+          direction.x = -1;
         }
       } else {
-        m_player->cTransform->velocity.x = 0;
+        direction.x = 0;
       }
     } else {
-      m_player->cTransform->velocity.y = 0;
+      direction.y = 0;
     }
-    if (m_player->cInput->left & !m_player->cInput->right) {
+    if (input.left & !input.right) {
       if (currentPosition.x < m_playerConfig.SR) {
         // it's collide with left edge it can't move left
-        m_player->cInput->left = false;
+        input.left = false;
       } else {
-        m_player->cTransform->velocity.x = -1;
+        direction.x = -1;
       }
-    } else if (m_player->cInput->right & !m_player->cInput->left) {
-      if (currentPosition.x > m_window.getSize().x - m_playerConfig.SR) {
+    } else if (input.right & !input.left) {
+      if (currentPosition.x > m_worldSize.x - m_playerConfig.SR) {
         // it's collide with right edge it can't move right
-        m_player->cInput->right = false;
+        input.right = false;
       } else {
-        m_player->cTransform->velocity.x = 1;
+        direction.x = 1;
       }
     } else {
-      m_player->cTransform->velocity.x = 0;
+      direction.x = 0;
     }
   } else {
-    m_player->cTransform->velocity = Vec2(0, 0);
+    direction = Vec2(0, 0);
   }
-  m_player->cTransform->pos.x +=
-      m_player->cTransform->velocity.x * m_playerConfig.S;
-  m_player->cTransform->pos.y +=
-      m_player->cTransform->velocity.y * m_playerConfig.S;
+  // the position itself is integrated together with all other entities
+  transform.velocity = direction * m_playerConfig.S;
 }
 
 void Game::sLifespan() {
-  // update lifetime counter for bullets
-  for (auto &entity : m_entities.getEntities("bullet")) {
-    entity->updateLifeSpanAndColor();
+  // bullets and small enemies whose lifespan ran out this tick are
+  // destroyed, the others are not visited; their fade is worked out when
+  // they are drawn
+  m_entities.expireLifespans();
+}
+
+void Game::fadeByLifespan(uint32_t entity, CShape &shape) {
+  // the alpha falls from full to zero over the lifespan, and stays at zero
+  // on the expiry tick
+  auto &lifespans = m_entities.lifespans();
+  if (!lifespans.has(entity)) {
+    return;
   }
-  // update lifetime counter for small enemy
-  for (auto &entity : m_entities.getEntities("smallEnemy")) {
-    entity->updateLifeSpanAndColor();
+  const CLifespan &lifespan = lifespans.get(entity);
+  int remaining = lifespan.remaining(m_entities.lifespanTick());
+  sf::Uint8 alpha = 0;
+  if (remaining > 0) {
+    float progress = static_cast<float>(remaining) / lifespan.total;
+    alpha = static_cast<sf::Uint8>(255 * (progress));
   }
+  shape.fill.a = alpha;
+  shape.outline.a = alpha;
 }
 
+// collision groups stored in the broadphase grid
+enum CollisionGroup { CollisionGroupEnemy, CollisionGroupSmallEnemy };
+
 void Game::sCollision() {
   // Implementation of all proper collisions between entities
 
-  for (auto entityBullet : m_entities.getEntities("bullet")) {
-    for (auto entityEnemy : m_entities.getEntities("enemy")) {
-      float distBE = entityBullet->cTransform->pos.dist(
-          entityEnemy->cTransform
-              ->pos); // get distance between Bullet and Enemy nodes.
-      float summRadius =
-          entityBullet->cCollision->radius +
-          entityEnemy->cCollision
-              ->radius; // get summ of radius of Bullet and Enemy.
-      if (distBE < summRadius) {
-        spawnSmallEnemies(entityEnemy);
-        entityEnemy->destroy();
-        entityBullet->destroy();
-        m_score += enemyScorePoints;
-      }
-    }
+  auto &transforms = m_entities.transforms();
+  auto &collisions = m_entities.collisions();
 
-    for (auto entitySmallEnemy : m_entities.getEntities("smallEnemy")) {
-      float distBSE = entityBullet->cTransform->pos.dist(
-          entitySmallEnemy->cTransform
-              ->pos); // get distance between Bullet and Small Enemy nodes.
-      float summRadius =
-          entityBullet->cCollision->radius +
-          entitySmallEnemy->cCollision
-              ->radius; // get summ of radius of Bullet and Small Enemy.
-      if (distBSE < summRadius) {
-        entitySmallEnemy->destroy();
-        entityBullet->destroy();
-        m_score += smallEnemyScorePoints;
-      }
-    }
+  // how far every entity moved in this tick's sMovement
+  m_motions.resize(transforms.size());
+  Vec2Batch::subtract(transforms.positions.data(),
+                      transforms.previousPositions.data(), m_motions.data(),
+                      m_motions.size());
+  auto motion = [&](const Entity *entity) {
+    return m_motions[transforms.indexOf(entity->index())];
+  };
+
+  // broadphase: bucket every enemy and small enemy into the uniform grid
+  m_collisionGrid.clear();
+  for (auto &entityEnemy : m_entities.getEntities(Tag::Enemy)) {
+    m_collisionGrid.insert(entityEnemy,
+                           transforms.get(entityEnemy->index()).pos,
+                           collisions.get(entityEnemy->index()).radius,
+                           CollisionGroupEnemy, motion(entityEnemy));
+  }
+  for (auto &entitySmallEnemy : m_entities.getEntities(Tag::SmallEnemy)) {
+    m_collisionGrid.insert(entitySmallEnemy,
+                           transforms.get(entitySmallEnemy->index()).pos,
+                           collisions.get(entitySmallEnemy->index()).radius,
+                           CollisionGroupSmallEnemy, motion(entitySmallEnemy));
   }
+  m_collisionGrid.build();
 
-  sf::Vector2u xRangeWindowSpawn =
-      sf::Vector2u(m_enemyConfig.SR, m_window.getSize().x - m_enemyConfig.SR);
-  sf::Vector2u yRangeWindowSpawn =
-      sf::Vector2u(m_enemyConfig.SR, m_window.getSize().y - m_enemyConfig.SR);
+  // Detection reads the world and writes one event per bullet, so it runs
+  // on the thread pool. Each bullet is swept over the whole tick against the
+  // enemies from nearby cells, which move over the tick as well, so a bullet
+  // faster than an enemy is wide cannot pass through it between two ticks.
+  // It hits the live enemy it touches first.
+  auto alive = [](const SpatialHash::Item &item) {
+    return item.entity->isActive();
+  };
+  const EntityVec &bullets = m_entities.getEntities(Tag::Bullet);
+  m_collisionEvents.resize(bullets.size());
+  m_threadPool.parallelFor(bullets.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      CollisionEvent &event = m_collisionEvents[i];
+      event.kind = CollisionEvent::None;
+      const Entity *entityBullet = bullets[i];
+      if (!entityBullet->isActive()) {
+        continue; // expired in sLifespan this tick
+      }
+      Vec2 bulletMotion = motion(entityBullet);
+      Vec2 bulletStart =
+          transforms.get(entityBullet->index()).pos - bulletMotion;
+      float bulletRadius = collisions.get(entityBullet->index()).radius;
+      float time = 0;
+      const SpatialHash::Item *hit = m_collisionGrid.querySwept(
+          bulletStart, bulletMotion, bulletRadius, time, alive);
+      if (hit == nullptr) {
+        continue;
+      }
+      event.first = entityBullet->handle();
+      event.second = hit->entity->handle();
+      event.time = time;
+      event.order = static_cast<uint32_t>(i);
+      event.kind = hit->group == CollisionGroupEnemy
+                       ? CollisionEvent::BulletEnemy
+                       : CollisionEvent::BulletSmallEnemy;
+    }
+  });
+  // the earliest hit in the tick gets an enemy two bullets reach
+  m_collisionEvents.erase(
+      std::remove_if(m_collisionEvents.begin(), m_collisionEvents.end(),
+                     [](const CollisionEvent &event) {
+                       return event.kind == CollisionEvent::None;
+                     }),
+      m_collisionEvents.end());
+  std::sort(m_collisionEvents.begin(), m_collisionEvents.end(),
+            [](const CollisionEvent &a, const CollisionEvent &b) {
+              if (a.time != b.time) {
+                return a.time < b.time;
+              }
+              return a.order < b.order;
+            });
 
-  Vec2 topLeftLimit = Vec2(m_enemyConfig.SR, m_enemyConfig.SR);
-  Vec2 bottomRightLimit = Vec2(m_window.getSize().x - m_enemyConfig.SR,
-                               m_window.getSize().y - m_enemyConfig.SR);
+  // Check if any enemy or small enemy is colliding with player and if it's
+  // collide player should respawn at center of screen. The hits are against
+  // the old position, so only the first one counts, after the bullets.
+  // The position and radius are copies, a reference into the pools would
+  // dangle once anything adds a transform while the grid is walked.
+  bool playerHit = false;
+  const Vec2 playerPosition = transforms.get(player()->index()).pos;
+  const float playerRadius = collisions.get(player()->index()).radius;
+  m_collisionGrid.queryOverlaps(
+      playerPosition, playerRadius, [&](const SpatialHash::Item &hit) {
+        if (playerHit || !hit.entity->isActive()) {
+          return;
+        }
+        playerHit = true;
+        CollisionEvent event;
+        event.first = m_player;
+        event.second = hit.entity->handle();
+        event.kind = CollisionEvent::PlayerEnemy;
+        m_collisionEvents.push_back(event);
+      });
 
-  // check if enemy object incide of window range if not then it should bounce
-  // from edge of the window
-  for (auto entityEnemy : m_entities.getEntities("enemy")) {
-    if (!(entityEnemy->cTransform->pos.x >= topLeftLimit.x &&
-          entityEnemy->cTransform->pos.x <= bottomRightLimit.x) ||
-        !(entityEnemy->cTransform->pos.y >= topLeftLimit.y &&
-          entityEnemy->cTransform->pos.y <= bottomRightLimit.y)) {
-      // check with which edge colliding enemy
-      Vec2 currentPosition = entityEnemy->cTransform->pos;
-      if (currentPosition.y > m_window.getSize().y - m_enemyConfig.SR &&
-          currentPosition.x < m_window.getSize().x - m_enemyConfig.SR) {
-        // it's collide with bottom edge
-        entityEnemy->cTransform->velocity.y = -1;
-      } else if (currentPosition.y < m_enemyConfig.SR &&
-                 currentPosition.x < m_window.getSize().x - m_enemyConfig.SR) {
-        // it's collide with up edge
-        entityEnemy->cTransform->velocity.y = 1;
-      } else if (currentPosition.y < m_window.getSize().y - m_enemyConfig.SR &&
-                 currentPosition.x < m_enemyConfig.SR) {
-        // it's collide with left edge
-        Vec2 velocityValue = entityEnemy->cTransform->velocity;
-        entityEnemy->cTransform->velocity.x = 1;
-
-      } else if (currentPosition.y < m_window.getSize().y - m_enemyConfig.SR &&
-                 currentPosition.x > m_window.getSize().x - m_enemyConfig.SR) {
-        // it's collide with right edge
-        entityEnemy->cTransform->velocity.x = -1;
-      }
+  // Response, in event order. An entity is only destroyed once: a later
+  // event with an entity an earlier one destroyed is dropped, so an enemy
+  // two bullets touched splits and scores once.
+  for (const CollisionEvent &event : m_collisionEvents) {
+    Entity *first = m_entities.getEntity(event.first);
+    Entity *second = m_entities.getEntity(event.second);
+    if (first == nullptr || second == nullptr || !first->isActive() ||
+        !second->isActive()) {
+      continue;
     }
-    // Check if enemy colliding with player and if it's collide player should
-    // respawn at center of screen
-    float distPE = m_player->cTransform->pos.dist(
-        entityEnemy->cTransform
-            ->pos); // get distance between Player and Enemy nodes.
-    float summRadius = m_player->cCollision->radius +
-                       entityEnemy->cCollision
-                           ->radius; // get summ of radius of Player and Enemy.
-    if (distPE < summRadius) {
-      entityEnemy->destroy();
-      m_player->destroy();
+    switch (event.kind) {
+    case CollisionEvent::BulletEnemy:
+      emitDebris(second, 1.0f);
+      spawnSmallEnemies(second);
+      second->destroy();
+      first->destroy();
+      m_score += enemyScorePoints;
+      break;
+    case CollisionEvent::BulletSmallEnemy:
+      emitDebris(second, 0.5f);
+      second->destroy();
+      first->destroy();
+      m_score += smallEnemyScorePoints;
+      break;
+    case CollisionEvent::PlayerEnemy:
+      emitDebris(first, 2.0f);
+      second->destroy();
+      first->destroy();
       spawnPlayer();
+      break;
+    default:
+      break;
     }
   }
-  // check if small enemy collide with player
-  for (auto entitySmallEnemy : m_entities.getEntities("smallEnemy")) {
-    float distPSE = m_player->cTransform->pos.dist(
-        entitySmallEnemy->cTransform
-            ->pos); // get distance between player and small enemy nodes
-    float summRadius = m_player->cCollision->radius +
-                       entitySmallEnemy->cCollision
-                           ->radius; // get summ of radius of player and enemy
-    if (distPSE < summRadius) {
-      entitySmallEnemy->destroy();
-      m_player->destroy();
-      spawnPlayer();
-    }
+
+  Vec2 topLeftLimit = Vec2(m_enemyConfig.SR, m_enemyConfig.SR);
+  Vec2 bottomRightLimit = Vec2(m_worldSize.x - m_enemyConfig.SR,
+                               m_worldSize.y - m_enemyConfig.SR);
+
+  // check if enemy object incide of window range if not then it should bounce
+  // from edge of the window. Enemies are the bounded range at the front of the
+  // transform pool, so the bounce kernel clamps them back inside and turns the
+  // velocity away from the edge they crossed.
+  Vec2 *positions = transforms.positions.data();
+  Vec2 *velocities = transforms.velocities.data();
+  m_threadPool.parallelFor(
+      transforms.boundedCount(), [=](size_t begin, size_t end) {
+        Simd::bounce(positions + begin, velocities + begin, end - begin,
+                     topLeftLimit, bottomRightLimit);
+      });
+}
+
+void Game::sParticles() { m_particles.update(m_threadPool); }
+
+void Game::emitDebris(Entity *entity, float amount) {
+  // the entity is destroyed right after, only its look is needed
+  if (m_particles.capacity() == 0 || !entity->isActive()) {
+    return;
   }
+  CShape shape = m_entities.shapes().get(entity->index());
+  fadeByLifespan(entity->index(), shape);
+  Vec2 pos = m_entities.transforms().get(entity->index()).pos;
+  size_t count = static_cast<size_t>(m_particlesPerKill * amount);
+  // mostly the fill color, with a share of outline fragments
+  m_particles.emit(pos, count - count / 4, shape.fill, m_particleSpeed,
+                   m_particleLifetime);
+  m_particles.emit(pos, count / 4, shape.outline, m_particleSpeed * 0.5f,
+                   m_particleLifetime);
 }
 
 void Game::sEnemySpawner() {
+  // wave mode, for pushing the population up to scale test the engine
+  if (m_waveConfig.K > 0) {
+    if (m_lastEnemySpawnTime < m_waveConfig.I) {
+      m_lastEnemySpawnTime++;
+    } else {
+      spawnWave();
+      m_lastEnemySpawnTime = 0;
+    }
+    return;
+  }
   // logic of spawning enemy every m_enemyConfig.SI time
   if (m_lastEnemySpawnTime < m_enemyConfig.SI) {
     m_lastEnemySpawnTime++;
@@ -483,54 +1145,292 @@ void Game::sEnemySpawner() {
   }
 }
 
-void Game::sRender() {
+void Game::spawnWave() {
+  // linear and exponential ramp, capped so the cast below cannot overflow
+  double size = m_waveConfig.K * std::pow(m_waveConfig.F, m_wave) +
+                static_cast<double>(m_waveConfig.G) * m_wave;
+  size_t count = static_cast<size_t>(std::min(size, double(1 << 26)));
+  count = std::min(count, m_entities.room());
+  for (size_t i = 0; i < count; ++i) {
+    spawnEnemy();
+  }
+  m_wave++;
+  m_waveSpawned = count;
+}
+
+void Game::sRender(float alpha, float ticks) {
+  if (m_headless) {
+    return;
+  }
+  RenderFrame &frame = m_renderQueue.back();
+  buildFrame(frame, alpha, ticks);
+  if (m_renderThread.joinable()) {
+    m_renderQueue.publish();
+  } else {
+    drawFrame(frame);
+  }
+}
+
+void Game::buildFrame(RenderFrame &frame, float alpha, float ticks) {
+  // spin every shape one degree per tick of elapsed time, the angle lives in
+  // the transform pool
+  std::vector<float> &angles = m_entities.transforms().angles;
+  m_threadPool.parallelFor(angles.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      angles[i] += ticks;
+    }
+  });
+
+  // every entity between its last two tick positions, the renderer decides
+  // what is visible
+  auto &transforms = m_entities.transforms();
+  m_renderPositions.resize(transforms.size());
+  m_threadPool.parallelFor(transforms.size(), [&](size_t begin, size_t end) {
+    Vec2Batch::lerp(transforms.previousPositions.data() + begin,
+                    transforms.positions.data() + begin, alpha,
+                    m_renderPositions.data() + begin, end - begin);
+  });
+  // the entities killed by the last tick stay in the list until the next
+  // update(), they are not drawn again
+  std::vector<Entity *> &entities = m_drawnEntities;
+  entities.clear();
+  for (Entity *entity : m_entities.getEntities()) {
+    if (entity->isActive()) {
+      entities.push_back(entity);
+    }
+  }
+  frame.shapes.resize(entities.size());
+  m_threadPool.parallelFor(entities.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      uint32_t slot = transforms.indexOf(entities[i]->index());
+      RenderShape &shape = frame.shapes[i];
+      shape.position = m_renderPositions[slot];
+      shape.angle = transforms.angles[slot];
+      shape.shape = m_entities.shapes().get(entities[i]->index());
+      fadeByLifespan(entities[i]->index(), shape.shape);
+    }
+  });
+  m_particles.buildVertices(alpha, 3.0f, m_threadPool, frame.particles);
+
+  frame.score = m_score;
+  frame.showProfiler = m_showProfiler;
+  if (m_showProfiler) {
+    // the statistics only change a little per frame, refresh them twice a
+    // second of wall time so they can be read at any tick or frame rate
+    if (RenderQueue::Clock::now() - m_profilerRefreshed >=
+        std::chrono::milliseconds(500)) {
+      updateProfilerText();
+    }
+    if (frame.profilerVersion != m_profilerVersion) {
+      frame.profilerText = m_profilerString;
+      frame.profilerVersion = m_profilerVersion;
+    }
+  }
+  frame.style = m_renderStyle;
+  frame.inputPolled = m_shownInputPolled;
+  frame.inputPreviousPoll = m_shownInputPreviousPoll;
+  m_shownInputPolled = RenderQueue::Clock::time_point();
+}
+
+void Game::drawFrame(const RenderFrame &frame) {
+  const RenderStyle &style = frame.style;
+  if (style.frameLimit != m_drawnStyle.frameLimit ||
+      style.fontSize != m_drawnStyle.fontSize ||
+      style.fontColor != m_drawnStyle.fontColor) {
+    m_window.setFramerateLimit(style.frameLimit);
+    m_text.setCharacterSize(style.fontSize);
+    m_text.setFillColor(style.fontColor);
+    m_profilerText.setCharacterSize(std::max(style.fontSize / 2, 10));
+    m_profilerText.setFillColor(style.fontColor);
+    m_profilerText.setPosition(0, style.fontSize * 1.5f);
+    m_drawnStyle = style;
+  }
   m_window.clear();
 
-  // Draw ALL of the entities
-  for (auto &entityNode : m_entities.getEntities()) {
-    // set the poisition of the shape based on the entity's transform->pos
-    entityNode->cShape->circle.setPosition(entityNode->cTransform->pos.x,
-                                           entityNode->cTransform->pos.y);
+  // the part of the world the window shows, and how many pixels a world
+  // unit covers there
+  const sf::View &view = m_window.getView();
+  Vec2 viewMin(view.getCenter().x - view.getSize().x / 2,
+               view.getCenter().y - view.getSize().y / 2);
+  Vec2 viewMax(view.getCenter().x + view.getSize().x / 2,
+               view.getCenter().y + view.getSize().y / 2);
+  float pixelsPerUnit = m_window.getSize().x / view.getSize().x;
+
+  // Build the visible entities into one vertex batch and draw it at once
+  m_shapeBatch.clear();
+  size_t drawn = 0;
+  size_t culled = 0;
+  size_t simplified = 0;
+  for (const RenderShape &entry : frame.shapes) {
+    const Vec2 &position = entry.position;
+    const CShape &shape = entry.shape;
 
-    // set the rotation of the shape based on the entity's transform->angle
-    entityNode->cTransform->angle += 1.0f;
-    entityNode->cShape->circle.setRotation(entityNode->cTransform->angle);
+    // skip shapes entirely outside the view, the mitered outline reaches at
+    // most twice its thickness past the radius
+    float extent = shape.radius + 2 * std::fabs(shape.thickness);
+    if (position.x + extent < viewMin.x || position.x - extent > viewMax.x ||
+        position.y + extent < viewMin.y || position.y - extent > viewMax.y) {
+      culled++;
+      continue;
+    }
 
-    // draw the entity`s sf::CircleShape
-    m_window.draw(entityNode->cShape->circle);
+    // small shapes lose their outline and then vertices, they are not
+    // told apart at that size anyway
+    float pixels = shape.radius * pixelsPerUnit;
+    int points = shape.points;
+    bool outlined = pixels >= style.lodOutline;
+    if (pixels < style.lodPolygon) {
+      points = std::min(points, style.lodPoints);
+    }
+    if (points != shape.points || (!outlined && shape.thickness != 0)) {
+      simplified++;
+    }
+    drawn++;
+
+    // rotated by its angle
+    m_shapeBatch.add(shape, position, entry.angle, points, outlined);
+  }
+  m_renderStats.drawn.store(drawn, std::memory_order_relaxed);
+  m_renderStats.culled.store(culled, std::memory_order_relaxed);
+  m_renderStats.simplified.store(simplified, std::memory_order_relaxed);
+  m_shapeBatch.draw(m_window);
+  // debris on top of the shapes, in one more draw call
+  if (!frame.particles.empty()) {
+    m_window.draw(frame.particles.data(), frame.particles.size(), sf::Quads);
   }
   // draw text score
-  m_text.setString("Score points: " + std::to_string(m_score));
+  // building the string allocates, so only do it when the score changed
+  if (frame.score != m_shownScore) {
+    m_shownScore = frame.score;
+    m_text.setString("Score points: " + std::to_string(frame.score));
+  }
   m_window.draw(m_text);
+  if (frame.showProfiler) {
+    if (frame.profilerVersion != m_shownProfilerVersion) {
+      m_shownProfilerVersion = frame.profilerVersion;
+      m_profilerText.setString(frame.profilerText);
+    }
+    m_window.draw(m_profilerText);
+  }
 
   m_window.display();
+  if (frame.inputPolled != RenderQueue::Clock::time_point()) {
+    typedef std::chrono::duration<float, std::milli> Milliseconds;
+    RenderQueue::Clock::time_point now = RenderQueue::Clock::now();
+    m_latency.record(Milliseconds(now - frame.inputPolled).count(),
+                     Milliseconds(now - frame.inputPreviousPoll).count());
+  }
+}
+
+void Game::startRenderThread() {
+  if (m_headless || !m_useRenderThread || m_renderThread.joinable()) {
+    return;
+  }
+  // the OpenGL context can only be active on one thread, the render thread
+  // takes it over; events are still polled here
+  m_window.setActive(false);
+  m_renderStopping = false;
+  m_renderThread = std::thread(&Game::renderLoop, this);
+}
+
+void Game::stopRenderThread() {
+  if (!m_renderThread.joinable()) {
+    return;
+  }
+  m_renderStopping = true;
+  m_renderThread.join();
+  m_window.setActive(true);
+}
+
+void Game::renderLoop() {
+  m_window.setActive(true);
+  unsigned spins = 0;
+  while (!m_renderStopping) {
+    const RenderFrame *frame = m_renderQueue.take();
+    if (!frame) {
+      RenderQueue::backoff(spins);
+      continue;
+    }
+    spins = 0;
+    drawFrame(*frame);
+    m_renderQueue.drawn();
+  }
+  m_window.setActive(false);
+}
+
+void Game::waitForRenderSlot(RenderQueue::Clock::duration lead) {
+  // at most one frame waits for the render thread, then wait for the moment
+  // the next one has to be started to be done in time
+  unsigned spins = 0;
+  while (!m_renderQueue.taken() && !m_renderStopping) {
+    RenderQueue::backoff(spins);
+  }
+  RenderQueue::Clock::time_point start = m_renderQueue.nextTake() - lead;
+  while (RenderQueue::Clock::now() < start) {
+    RenderQueue::backoff(spins);
+  }
+}
+
+void Game::waitForFrameSlot(RenderQueue::Clock::time_point lastFrame) {
+  if (m_frameLimit <= 0) {
+    return;
+  }
+  // a late frame is not caught up on, the next one starts right away
+  RenderQueue::Clock::time_point start =
+      lastFrame + std::chrono::duration_cast<RenderQueue::Clock::duration>(
+                      std::chrono::duration<double>(1.0 / m_frameLimit));
+  unsigned spins = 0;
+  while (RenderQueue::Clock::now() < start) {
+    RenderQueue::backoff(spins);
+  }
 }
 
 void Game::sUserInput() {
   // Handle input event of player and updata player cInput component state
   // and also process mouse button input event
+  if (m_headless) {
+    return;
+  }
+
+  // events carry no time, each one is timed from this poll and the one
+  // before, it arrived in between
+  RenderQueue::Clock::time_point now = RenderQueue::Clock::now();
+  RenderQueue::Clock::time_point previous =
+      m_lastPoll == RenderQueue::Clock::time_point() ? now : m_lastPoll;
+  m_lastPoll = now;
 
   sf::Event event;
   while (m_window.pollEvent(event)) {
+    CInput &input = m_entities.inputs().get(player()->index());
+
     // this event triggers when the window is closed
     if (event.type == sf::Event::Closed) {
       m_running = false;
     }
 
+    // the oldest input not yet on screen is the one that waits longest
+    if ((event.type == sf::Event::KeyPressed ||
+         event.type == sf::Event::KeyReleased ||
+         event.type == sf::Event::MouseButtonPressed) &&
+        m_inputPolled == RenderQueue::Clock::time_point()) {
+      m_inputPolled = now;
+      m_inputPreviousPoll = previous;
+    }
+
     // this event is triggered when a key is pressed
     if (event.type == sf::Event::KeyPressed) {
       switch (event.key.code) {
       case sf::Keyboard::W:
-        m_player->cInput->up = true;
+        input.up = true;
         break;
       case sf::Keyboard::A:
-        m_player->cInput->left = true;
+        input.left = true;
         break;
       case sf::Keyboard::S:
-        m_player->cInput->down = true;
+        input.down = true;
         break;
       case sf::Keyboard::D:
-        m_player->cInput->right = true;
+        input.right = true;
         break;
       default:
         break;
@@ -541,16 +1441,16 @@ void Game::sUserInput() {
     if (event.type == sf::Event::KeyReleased) {
       switch (event.key.code) {
       case sf::Keyboard::W:
-        m_player->cInput->up = false;
+        input.up = false;
         break;
       case sf::Keyboard::A:
-        m_player->cInput->left = false;
+        input.left = false;
         break;
       case sf::Keyboard::S:
-        m_player->cInput->down = false;
+        input.down = false;
         break;
       case sf::Keyboard::D:
-        m_player->cInput->right = false;
+        input.right = false;
         break;
       default:
         break;
@@ -562,14 +1462,14 @@ void Game::sUserInput() {
         if (m_paused) {
           return;
         }
-        spawnBullet(m_player, Vec2(event.mouseButton.x, event.mouseButton.y));
+        spawnBullet(player(), Vec2(event.mouseButton.x, event.mouseButton.y));
       }
 
       if (event.mouseButton.button == sf::Mouse::Right) {
         if (m_paused) {
           return;
         }
-        spawnSpecialWeapon(m_player);
+        spawnSpecialWeapon(player());
       }
     }
 
@@ -578,9 +1478,86 @@ void Game::sUserInput() {
       case sf::Keyboard::P:
         setPaused(!m_paused);
         break;
+      case sf::Keyboard::F3:
+        // the profiler only records while its overlay is shown, or for the
+        // whole run when a trace was requested
+        m_showProfiler = !m_showProfiler;
+        m_profiler.setEnabled(m_showProfiler || m_traceOnExit);
+        updateProfilerText();
+        break;
+      case sf::Keyboard::F4:
+        writeTrace();
+        break;
+      case sf::Keyboard::F5:
+        if (saveSnapshot(m_snapshotPath)) {
+          std::cout << "Saved " << m_snapshotPath << std::endl;
+        }
+        break;
+      case sf::Keyboard::F9:
+        // the events left in this poll are for the world before the load
+        if (loadSnapshot(m_snapshotPath)) {
+          std::cout << "Loaded " << m_snapshotPath << std::endl;
+          return;
+        }
+        break;
+      case sf::Keyboard::Backspace:
+        m_rewinding = true;
+        break;
       default:
         break;
       }
     }
+
+    if (event.type == sf::Event::KeyReleased &&
+        event.key.code == sf::Keyboard::Backspace) {
+      m_rewinding = false;
+    }
+  }
+}
+
+void Game::updateProfilerText() {
+  // rolling average and 99th percentile per zone over the profiler history
+  std::string text = "zone: avg / p99 ms over " +
+                     std::to_string(m_profiler.frames()) + " frames\n";
+  char line[96];
+  for (uint8_t zone = 0; zone < Zone::Count; ++zone) {
+    snprintf(line, sizeof(line), "%s: %.3f / %.3f\n", Profiler::zoneName(zone),
+             m_profiler.average(zone), m_profiler.percentile(zone, 0.99));
+    text += line;
+  }
+  for (TagId tag : {Tag::Player, Tag::Enemy, Tag::SmallEnemy, Tag::Bullet}) {
+    text += m_entities.tagName(tag) + ": " +
+            std::to_string(m_entities.getEntities(tag).size()) + "  ";
+  }
+  text += "particles: " + std::to_string(m_particles.size());
+  // written by the renderer, one frame behind with the render thread
+  text += "\ndrawn: " + std::to_string(m_renderStats.drawn.load()) +
+          "  culled: " + std::to_string(m_renderStats.culled.load()) +
+          "  simplified: " + std::to_string(m_renderStats.simplified.load());
+  text += "\nheap allocations last frame: " +
+          std::to_string(m_frameAllocations);
+  std::string latency = latencySummary();
+  if (!latency.empty()) {
+    text += "\n" + latency;
+  }
+  m_profilerString = text;
+  m_profilerVersion++;
+  m_profilerRefreshed = RenderQueue::Clock::now();
+}
+
+std::string Game::latencySummary() {
+  size_t samples = m_latency.samples();
+  if (samples == 0) {
+    return std::string();
   }
+  // each percentile as the range the latency is known to lie in
+  float p50From = 0, p50To = 0, p99From = 0, p99To = 0;
+  m_latency.percentile(0.5, p50From, p50To, m_latencyScratch);
+  m_latency.percentile(0.99, p99From, p99To, m_latencyScratch);
+  char text[128];
+  snprintf(text, sizeof(text),
+           "input to display ms: p50 %.2f-%.2f  p99 %.2f-%.2f over %zu "
+           "inputs",
+           p50From, p50To, p99From, p99To, samples);
+  return text;
 }
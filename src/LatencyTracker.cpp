@@ -0,0 +1,50 @@
+#include "../include/LatencyTracker.h"
+
+#include <algorithm>
+
+LatencyTracker::LatencyTracker() {
+  for (size_t i = 0; i < historySamples; ++i) {
+    m_fromPoll[i].store(0, std::memory_order_relaxed);
+    m_fromPreviousPoll[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyTracker::record(float fromPollMs, float fromPreviousPollMs) {
+  uint64_t count = m_count.load(std::memory_order_relaxed);
+  size_t slot = count % historySamples;
+  m_fromPoll[slot].store(fromPollMs, std::memory_order_relaxed);
+  m_fromPreviousPoll[slot].store(fromPreviousPollMs,
+                                 std::memory_order_relaxed);
+  m_count.store(count + 1, std::memory_order_release);
+}
+
+size_t LatencyTracker::samples() const {
+  return static_cast<size_t>(std::min<uint64_t>(
+      m_count.load(std::memory_order_acquire), historySamples));
+}
+
+namespace {
+float percentileOf(std::vector<float> &values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+  std::nth_element(values.begin(), values.begin() + rank, values.end());
+  return values[rank];
+}
+} // namespace
+
+void LatencyTracker::percentile(double p, float &fromPollMs,
+                                float &fromPreviousPollMs,
+                                std::vector<float> &scratch) const {
+  size_t count = samples();
+  scratch.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    scratch[i] = m_fromPoll[i].load(std::memory_order_relaxed);
+  }
+  fromPollMs = percentileOf(scratch, p);
+  for (size_t i = 0; i < count; ++i) {
+    scratch[i] = m_fromPreviousPoll[i].load(std::memory_order_relaxed);
+  }
+  fromPreviousPollMs = percentileOf(scratch, p);
+}
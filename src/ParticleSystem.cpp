@@ -0,0 +1,115 @@
+#include "../include/ParticleSystem.h"
+#include "../include/SimdKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+float ParticleSystem::randomUnit() {
+  // xorshift32, plenty for scattering debris
+  m_random ^= m_random << 13;
+  m_random ^= m_random >> 17;
+  m_random ^= m_random << 5;
+  return (m_random >> 8) * (1.0f / 16777216.0f);
+}
+
+size_t ParticleSystem::tail() const {
+  return (m_head + m_capacity - m_count) % m_capacity;
+}
+
+void ParticleSystem::reset(size_t capacity) {
+  m_capacity = capacity;
+  m_head = 0;
+  m_count = 0;
+  m_positions.assign(capacity, Vec2());
+  m_velocities.assign(capacity, Vec2());
+  m_ages.assign(capacity, 0.0f);
+  m_lifetimes.assign(capacity, 0.0f);
+  m_colors.assign(capacity, sf::Color());
+}
+
+size_t ParticleSystem::capacity() const { return m_capacity; }
+
+size_t ParticleSystem::size() const { return m_count; }
+
+void ParticleSystem::emit(const Vec2 &pos, size_t count,
+                          const sf::Color &color, float maxSpeed,
+                          float lifetime) {
+  if (m_capacity == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    float angle = randomUnit() * 2.0f * static_cast<float>(M_PI);
+    float speed = maxSpeed * (0.2f + 0.8f * randomUnit());
+    m_positions[m_head] = pos;
+    m_velocities[m_head] =
+        Vec2(std::cos(angle) * speed, std::sin(angle) * speed);
+    m_ages[m_head] = 0.0f;
+    // vary the lifetimes a little so a burst does not vanish in one tick
+    m_lifetimes[m_head] = lifetime * (0.75f + 0.5f * randomUnit());
+    m_colors[m_head] = color;
+    m_head = (m_head + 1) % m_capacity;
+    // a full ring recycles its oldest particle
+    m_count = std::min(m_count + 1, m_capacity);
+  }
+}
+
+void ParticleSystem::update(ThreadPool &pool) {
+  if (m_count == 0) {
+    return;
+  }
+  Vec2 *positions = m_positions.data();
+  const Vec2 *velocities = m_velocities.data();
+  float *ages = m_ages.data();
+  auto step = [=](size_t begin, size_t end) {
+    Simd::integrate(positions + begin, velocities + begin, end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      ages[i] += 1.0f;
+    }
+  };
+  // the window wraps around the end of the ring at most once
+  size_t first = tail();
+  size_t firstSpan = std::min(m_count, m_capacity - first);
+  pool.parallelFor(firstSpan, [=](size_t begin, size_t end) {
+    step(first + begin, first + end);
+  });
+  pool.parallelFor(m_count - firstSpan, step);
+
+  // retire the expired particles at the old end of the window, the ones in
+  // the middle are skipped when drawing until they reach it
+  while (m_count > 0 && m_ages[first] >= m_lifetimes[first]) {
+    first = (first + 1) % m_capacity;
+    m_count--;
+  }
+}
+
+void ParticleSystem::buildVertices(float alpha, float size, ThreadPool &pool,
+                                   std::vector<sf::Vertex> &vertices) const {
+  vertices.resize(m_count * 4);
+  if (m_count == 0) {
+    return;
+  }
+  size_t first = tail();
+  float half = size * 0.5f;
+  float behind = 1.0f - alpha;
+  pool.parallelFor(m_count, [&](size_t begin, size_t end) {
+    sf::Vertex *vertex = vertices.data() + begin * 4;
+    size_t slot = first + begin;
+    for (size_t i = begin; i < end; ++i, ++slot) {
+      if (slot >= m_capacity) {
+        slot -= m_capacity;
+      }
+      float life = m_ages[slot] / m_lifetimes[slot];
+      sf::Color color = m_colors[slot];
+      color.a = life < 1.0f ? static_cast<sf::Uint8>(color.a * (1.0f - life))
+                            : 0;
+      const Vec2 &p = m_positions[slot];
+      const Vec2 &v = m_velocities[slot];
+      float x = p.x - v.x * behind;
+      float y = p.y - v.y * behind;
+      *vertex++ = sf::Vertex(sf::Vector2f(x - half, y - half), color);
+      *vertex++ = sf::Vertex(sf::Vector2f(x + half, y - half), color);
+      *vertex++ = sf::Vertex(sf::Vector2f(x + half, y + half), color);
+      *vertex++ = sf::Vertex(sf::Vector2f(x - half, y + half), color);
+    }
+  });
+}
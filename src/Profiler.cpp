@@ -0,0 +1,119 @@
+#include "../include/Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+static const char *s_zoneNames[Zone::Count] = {
+    "Frame",         "EntityManager::update", "sUserInput", "sMovement",
+    "sLifespan",     "sEnemySpawner",         "sCollision", "sParticles",
+    "Rewind",        "sRender"};
+
+Profiler::Profiler(size_t historyFrames)
+    : m_history(std::max<size_t>(historyFrames, 1)), m_origin(Clock::now()),
+      m_totals(m_history * Zone::Count, 0.0f), m_events(m_history) {
+  m_scratch.reserve(m_history);
+}
+
+void Profiler::setEnabled(bool enabled) {
+  m_enabled = enabled;
+  if (!enabled) {
+    m_inFrame = false;
+  }
+}
+
+bool Profiler::enabled() const { return m_enabled; }
+
+void Profiler::beginFrame() {
+  if (!m_enabled) {
+    return;
+  }
+  m_inFrame = true;
+  m_frameStart = Clock::now();
+  // reuse the oldest slot, clear() keeps the capacity of its event list
+  std::fill_n(m_totals.begin() + m_cursor * Zone::Count, Zone::Count, 0.0f);
+  m_events[m_cursor].clear();
+}
+
+void Profiler::endFrame() {
+  if (!m_inFrame) {
+    return;
+  }
+  record(Zone::Frame, m_frameStart, Clock::now());
+  m_inFrame = false;
+  m_cursor = (m_cursor + 1) % m_history;
+  m_frames = std::min(m_frames + 1, m_history);
+}
+
+void Profiler::record(uint8_t zone, Clock::time_point start,
+                      Clock::time_point end) {
+  if (!m_inFrame) {
+    return;
+  }
+  int64_t duration =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count();
+  m_totals[m_cursor * Zone::Count + zone] += duration * 1e-6f;
+  m_events[m_cursor].push_back(
+      Event{zone,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(start -
+                                                                 m_origin)
+                .count(),
+            duration});
+}
+
+size_t Profiler::frames() const { return m_frames; }
+
+// finished frames are the m_frames slots before m_cursor
+double Profiler::average(uint8_t zone) const {
+  if (m_frames == 0) {
+    return 0;
+  }
+  double sum = 0;
+  for (size_t i = 1; i <= m_frames; ++i) {
+    size_t slot = (m_cursor + m_history - i) % m_history;
+    sum += m_totals[slot * Zone::Count + zone];
+  }
+  return sum / m_frames;
+}
+
+double Profiler::percentile(uint8_t zone, double p) {
+  if (m_frames == 0) {
+    return 0;
+  }
+  m_scratch.clear();
+  for (size_t i = 1; i <= m_frames; ++i) {
+    size_t slot = (m_cursor + m_history - i) % m_history;
+    m_scratch.push_back(m_totals[slot * Zone::Count + zone]);
+  }
+  size_t rank = std::min(static_cast<size_t>(p * m_frames), m_frames - 1);
+  std::nth_element(m_scratch.begin(), m_scratch.begin() + rank,
+                   m_scratch.end());
+  return m_scratch[rank];
+}
+
+const char *Profiler::zoneName(uint8_t zone) {
+  return zone < Zone::Count ? s_zoneNames[zone] : "?";
+}
+
+bool Profiler::writeTrace(const std::string &path) const {
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    return false;
+  }
+  // complete ("X") events with microsecond timestamps, oldest frame first
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  bool first = true;
+  for (size_t i = m_frames; i >= 1; --i) {
+    size_t slot = (m_cursor + m_history - i) % m_history;
+    for (const Event &event : m_events[slot]) {
+      out << (first ? "\n" : ",\n") << "{\"name\":\"" << zoneName(event.zone)
+          << "\",\"cat\":\"system\",\"ph\":\"X\",\"ts\":"
+          << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0
+          << ",\"pid\":1,\"tid\":1}";
+      first = false;
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return static_cast<bool>(out);
+}
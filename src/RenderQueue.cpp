@@ -0,0 +1,65 @@
+#include "../include/RenderQueue.h"
+
+#include <thread>
+
+namespace {
+int64_t ticksOf(RenderQueue::Clock::time_point time) {
+  return time.time_since_epoch().count();
+}
+} // namespace
+
+void RenderQueue::reserve(size_t shapes, size_t particleVertices) {
+  for (RenderFrame &frame : m_frames) {
+    frame.shapes.reserve(shapes);
+    frame.particles.reserve(particleVertices);
+  }
+}
+
+RenderFrame &RenderQueue::back() { return m_frames[m_back]; }
+
+void RenderQueue::publish() {
+  // the release makes the frame contents visible to the thread taking it,
+  // a frame published before and never taken comes back as the new back
+  uint8_t old = m_middle.exchange(m_back | Fresh, std::memory_order_acq_rel);
+  m_back = old & IndexMask;
+}
+
+bool RenderQueue::taken() const {
+  return (m_middle.load(std::memory_order_acquire) & Fresh) == 0;
+}
+
+RenderQueue::Clock::time_point RenderQueue::nextTake() const {
+  int64_t at = m_takenAt.load(std::memory_order_relaxed) +
+               m_drawTime.load(std::memory_order_relaxed);
+  return Clock::time_point(Clock::duration(at));
+}
+
+const RenderFrame *RenderQueue::take() {
+  if ((m_middle.load(std::memory_order_relaxed) & Fresh) == 0) {
+    return nullptr;
+  }
+  uint8_t old = m_middle.exchange(m_front, std::memory_order_acq_rel);
+  m_front = old & IndexMask;
+  m_takenAt.store(ticksOf(Clock::now()), std::memory_order_relaxed);
+  return &m_frames[m_front];
+}
+
+void RenderQueue::drawn() {
+  // moving average over about 8 frames, one slow frame does not throw the
+  // estimate off
+  int64_t time =
+      ticksOf(Clock::now()) - m_takenAt.load(std::memory_order_relaxed);
+  int64_t average = m_drawTime.load(std::memory_order_relaxed);
+  m_drawTime.store(average + (time - average) / 8, std::memory_order_relaxed);
+}
+
+void RenderQueue::backoff(unsigned &spins) {
+  if (spins < 64) {
+    spins++;
+  } else if (spins < 128) {
+    spins++;
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
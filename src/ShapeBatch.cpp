@@ -0,0 +1,88 @@
+#include "../include/ShapeBatch.h"
+
+#include <cmath>
+
+const ShapeBatch::UnitPolygon &ShapeBatch::unitPolygon(int points,
+                                                       float radius) {
+  auto key = std::make_pair(points, radius);
+  auto found = m_polygons.find(key);
+  if (found != m_polygons.end()) {
+    return found->second;
+  }
+
+  // same vertex layout as sf::CircleShape: the first point is straight up.
+  // The outline of a regular polygon is mitered, so each outer vertex sits
+  // along the vertex direction at thickness / cos(pi / points).
+  UnitPolygon polygon;
+  float miterLength = 1.0f / std::cos(M_PI / points);
+  for (int i = 0; i < points; ++i) {
+    float angle = i * 2 * M_PI / points - M_PI / 2;
+    sf::Vector2f direction(std::cos(angle), std::sin(angle));
+    polygon.points.push_back(
+        sf::Vector2f(direction.x * radius, direction.y * radius));
+    polygon.miters.push_back(
+        sf::Vector2f(direction.x * miterLength, direction.y * miterLength));
+  }
+  return m_polygons.emplace(key, std::move(polygon)).first->second;
+}
+
+void ShapeBatch::clear() { m_vertices.clear(); }
+
+void ShapeBatch::add(const CShape &shape, const Vec2 &pos, float angle) {
+  add(shape, pos, angle, shape.points, shape.thickness != 0);
+}
+
+void ShapeBatch::add(const CShape &shape, const Vec2 &pos, float angle,
+                     int points, bool outlined) {
+  if (points < 3) {
+    return;
+  }
+  const UnitPolygon &polygon = unitPolygon(points, shape.radius);
+  size_t count = polygon.points.size();
+
+  // rotate and translate the cached polygon once per entity
+  float radians = angle * M_PI / 180;
+  float cosAngle = std::cos(radians);
+  float sinAngle = std::sin(radians);
+  m_scratch.resize(2 * count);
+  sf::Vector2f *inner = m_scratch.data();
+  sf::Vector2f *outer = inner + count;
+  for (size_t i = 0; i < count; ++i) {
+    sf::Vector2f local = polygon.points[i];
+    inner[i] = sf::Vector2f(pos.x + local.x * cosAngle - local.y * sinAngle,
+                            pos.y + local.x * sinAngle + local.y * cosAngle);
+    local.x += polygon.miters[i].x * shape.thickness;
+    local.y += polygon.miters[i].y * shape.thickness;
+    outer[i] = sf::Vector2f(pos.x + local.x * cosAngle - local.y * sinAngle,
+                            pos.y + local.x * sinAngle + local.y * cosAngle);
+  }
+
+  // fill as a fan of triangles around the centre, then the outline ring as
+  // two triangles per edge, so the outline is drawn over the fill
+  outlined = outlined && shape.thickness != 0;
+  size_t first = m_vertices.getVertexCount();
+  m_vertices.resize(first + (outlined ? 9 : 3) * count);
+  sf::Vertex *vertex = &m_vertices[first];
+  sf::Vector2f center(pos.x, pos.y);
+  for (size_t i = 0; i < count; ++i) {
+    size_t next = (i + 1) % count;
+    *vertex++ = sf::Vertex(center, shape.fill);
+    *vertex++ = sf::Vertex(inner[i], shape.fill);
+    *vertex++ = sf::Vertex(inner[next], shape.fill);
+  }
+  if (outlined) {
+    for (size_t i = 0; i < count; ++i) {
+      size_t next = (i + 1) % count;
+      *vertex++ = sf::Vertex(inner[i], shape.outline);
+      *vertex++ = sf::Vertex(outer[i], shape.outline);
+      *vertex++ = sf::Vertex(inner[next], shape.outline);
+      *vertex++ = sf::Vertex(inner[next], shape.outline);
+      *vertex++ = sf::Vertex(outer[i], shape.outline);
+      *vertex++ = sf::Vertex(outer[next], shape.outline);
+    }
+  }
+}
+
+void ShapeBatch::draw(sf::RenderTarget &target) const {
+  target.draw(m_vertices);
+}
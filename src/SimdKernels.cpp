@@ -0,0 +1,498 @@
+#include "../include/SimdKernels.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(Vec2) == 2 * sizeof(float),
+              "kernels treat Vec2 arrays as interleaved float arrays");
+
+namespace Simd {
+
+// ---------------------------------------------------------------- scalar
+
+static void integrateScalar(Vec2 *positions, const Vec2 *velocities,
+                            size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    positions[i].x += velocities[i].x;
+    positions[i].y += velocities[i].y;
+  }
+}
+
+static void bounceAxis(float &pos, float &velocity, float min, float max) {
+  if (pos < min) {
+    pos = min;
+    velocity = std::fabs(velocity);
+  } else if (pos > max) {
+    pos = max;
+    velocity = -std::fabs(velocity);
+  }
+}
+
+static void bounceScalar(Vec2 *positions, Vec2 *velocities, size_t count,
+                         const Vec2 &min, const Vec2 &max) {
+  for (size_t i = 0; i < count; ++i) {
+    bounceAxis(positions[i].x, velocities[i].x, min.x, max.x);
+    bounceAxis(positions[i].y, velocities[i].y, min.y, max.y);
+  }
+}
+
+static size_t overlapsScalar(const Vec2 *positions, const float *radii,
+                             size_t count, const Vec2 &probe,
+                             float probeRadius, uint32_t *hits) {
+  size_t hitCount = 0;
+  for (size_t i = 0; i < count; ++i) {
+    float dx = positions[i].x - probe.x;
+    float dy = positions[i].y - probe.y;
+    float reach = radii[i] + probeRadius;
+    if (dx * dx + dy * dy < reach * reach) {
+      hits[hitCount++] = static_cast<uint32_t>(i);
+    }
+  }
+  return hitCount;
+}
+
+// The probe relative to circle i starts at s and moves by d, so they touch
+// when |s + t d| = reach: a t^2 + 2 b t + c = 0 with a = d.d, b = s.d and
+// c = s.s - reach^2. Already overlapping (c < 0) is a hit at 0, otherwise
+// the first root (-b - sqrt(b^2 - a c)) / a has to be real and within the
+// tick. The vector versions do the same operations in the same order so
+// every instruction set reports the same times.
+static size_t sweepScalar(const Vec2 *positions, const Vec2 *motions,
+                          const float *radii, size_t count, const Vec2 &probe,
+                          const Vec2 &probeMotion, float probeRadius,
+                          uint32_t *hits, float *times) {
+  size_t hitCount = 0;
+  for (size_t i = 0; i < count; ++i) {
+    float sx = probe.x - (positions[i].x - motions[i].x);
+    float sy = probe.y - (positions[i].y - motions[i].y);
+    float dx = probeMotion.x - motions[i].x;
+    float dy = probeMotion.y - motions[i].y;
+    float reach = radii[i] + probeRadius;
+    float a = dx * dx + dy * dy;
+    float b = sx * dx + sy * dy;
+    float c = (sx * sx + sy * sy) - reach * reach;
+    if (c < 0) {
+      hits[hitCount] = static_cast<uint32_t>(i);
+      times[hitCount++] = 0;
+      continue;
+    }
+    float discriminant = b * b - a * c;
+    if (b >= 0 || discriminant < 0) {
+      continue; // moving apart or passing wide
+    }
+    float root = -b - std::sqrt(discriminant);
+    if (root <= a) {
+      hits[hitCount] = static_cast<uint32_t>(i);
+      times[hitCount++] = root / a;
+    }
+  }
+  return hitCount;
+}
+
+#ifdef SIMD_X86
+
+// ---------------------------------------------------------------- SSE2
+
+static void integrateSse2(Vec2 *positions, const Vec2 *velocities,
+                          size_t count) {
+  float *pos = &positions[0].x;
+  const float *vel = &velocities[0].x;
+  size_t floats = count * 2;
+  size_t i = 0;
+  for (; i + 4 <= floats; i += 4) {
+    _mm_storeu_ps(pos + i,
+                  _mm_add_ps(_mm_loadu_ps(pos + i), _mm_loadu_ps(vel + i)));
+  }
+  integrateScalar(positions + i / 2, velocities + i / 2, count - i / 2);
+}
+
+static void bounceSse2(Vec2 *positions, Vec2 *velocities, size_t count,
+                       const Vec2 &min, const Vec2 &max) {
+  float *pos = &positions[0].x;
+  float *vel = &velocities[0].x;
+  size_t floats = count * 2;
+  // bounds repeat as x, y, x, y to match the interleaved layout
+  const __m128 lower = _mm_setr_ps(min.x, min.y, min.x, min.y);
+  const __m128 upper = _mm_setr_ps(max.x, max.y, max.x, max.y);
+  const __m128 signBit = _mm_set1_ps(-0.0f);
+  size_t i = 0;
+  for (; i + 4 <= floats; i += 4) {
+    __m128 p = _mm_loadu_ps(pos + i);
+    __m128 v = _mm_loadu_ps(vel + i);
+    __m128 below = _mm_cmplt_ps(p, lower);
+    __m128 above = _mm_cmpgt_ps(p, upper);
+    __m128 speed = _mm_andnot_ps(signBit, v);
+    v = _mm_or_ps(_mm_andnot_ps(_mm_or_ps(below, above), v),
+                  _mm_or_ps(_mm_and_ps(below, speed),
+                            _mm_and_ps(above, _mm_or_ps(speed, signBit))));
+    _mm_storeu_ps(pos + i, _mm_min_ps(_mm_max_ps(p, lower), upper));
+    _mm_storeu_ps(vel + i, v);
+  }
+  bounceScalar(positions + i / 2, velocities + i / 2, count - i / 2, min,
+               max);
+}
+
+static size_t overlapsSse2(const Vec2 *positions, const float *radii,
+                           size_t count, const Vec2 &probe, float probeRadius,
+                           uint32_t *hits) {
+  const float *pos = &positions[0].x;
+  const __m128 probeX = _mm_set1_ps(probe.x);
+  const __m128 probeY = _mm_set1_ps(probe.y);
+  const __m128 probeR = _mm_set1_ps(probeRadius);
+  size_t hitCount = 0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    // x0 y0 x1 y1 | x2 y2 x3 y3 -> x0 x1 x2 x3 and y0 y1 y2 y3
+    __m128 a = _mm_loadu_ps(pos + 2 * i);
+    __m128 b = _mm_loadu_ps(pos + 2 * i + 4);
+    __m128 dx = _mm_sub_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                           probeX);
+    __m128 dy = _mm_sub_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)),
+                           probeY);
+    __m128 reach = _mm_add_ps(_mm_loadu_ps(radii + i), probeR);
+    __m128 distSquared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    int mask = _mm_movemask_ps(_mm_cmplt_ps(distSquared,
+                                            _mm_mul_ps(reach, reach)));
+    while (mask) {
+      int lane = __builtin_ctz(mask);
+      hits[hitCount++] = static_cast<uint32_t>(i + lane);
+      mask &= mask - 1;
+    }
+  }
+  size_t tail = overlapsScalar(positions + i, radii + i, count - i, probe,
+                               probeRadius, hits + hitCount);
+  for (size_t t = hitCount; t < hitCount + tail; ++t) {
+    hits[t] += static_cast<uint32_t>(i);
+  }
+  return hitCount + tail;
+}
+
+static size_t sweepSse2(const Vec2 *positions, const Vec2 *motions,
+                        const float *radii, size_t count, const Vec2 &probe,
+                        const Vec2 &probeMotion, float probeRadius,
+                        uint32_t *hits, float *times) {
+  const float *pos = &positions[0].x;
+  const float *mot = &motions[0].x;
+  const __m128 probeX = _mm_set1_ps(probe.x);
+  const __m128 probeY = _mm_set1_ps(probe.y);
+  const __m128 probeMotionX = _mm_set1_ps(probeMotion.x);
+  const __m128 probeMotionY = _mm_set1_ps(probeMotion.y);
+  const __m128 probeR = _mm_set1_ps(probeRadius);
+  const __m128 zero = _mm_setzero_ps();
+  size_t hitCount = 0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 a0 = _mm_loadu_ps(pos + 2 * i);
+    __m128 a1 = _mm_loadu_ps(pos + 2 * i + 4);
+    __m128 m0 = _mm_loadu_ps(mot + 2 * i);
+    __m128 m1 = _mm_loadu_ps(mot + 2 * i + 4);
+    __m128 mx = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 my = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(3, 1, 3, 1));
+    __m128 sx = _mm_sub_ps(
+        probeX,
+        _mm_sub_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)), mx));
+    __m128 sy = _mm_sub_ps(
+        probeY,
+        _mm_sub_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)), my));
+    __m128 dx = _mm_sub_ps(probeMotionX, mx);
+    __m128 dy = _mm_sub_ps(probeMotionY, my);
+    __m128 reach = _mm_add_ps(_mm_loadu_ps(radii + i), probeR);
+    __m128 a = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    __m128 b = _mm_add_ps(_mm_mul_ps(sx, dx), _mm_mul_ps(sy, dy));
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy)),
+                          _mm_mul_ps(reach, reach));
+    __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+    __m128 root = _mm_sub_ps(_mm_sub_ps(zero, b),
+                             _mm_sqrt_ps(_mm_max_ps(discriminant, zero)));
+    __m128 inside = _mm_cmplt_ps(c, zero);
+    __m128 crossing =
+        _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(b, zero),
+                              _mm_cmpge_ps(discriminant, zero)),
+                   _mm_cmple_ps(root, a));
+    int mask = _mm_movemask_ps(_mm_or_ps(inside, crossing));
+    if (mask == 0) {
+      continue;
+    }
+    alignas(16) float laneTimes[4];
+    _mm_store_ps(laneTimes, _mm_andnot_ps(inside, _mm_div_ps(root, a)));
+    while (mask) {
+      int lane = __builtin_ctz(mask);
+      hits[hitCount] = static_cast<uint32_t>(i + lane);
+      times[hitCount++] = laneTimes[lane];
+      mask &= mask - 1;
+    }
+  }
+  size_t tail = sweepScalar(positions + i, motions + i, radii + i, count - i,
+                            probe, probeMotion, probeRadius, hits + hitCount,
+                            times + hitCount);
+  for (size_t t = hitCount; t < hitCount + tail; ++t) {
+    hits[t] += static_cast<uint32_t>(i);
+  }
+  return hitCount + tail;
+}
+
+// ---------------------------------------------------------------- AVX2
+
+__attribute__((target("avx2"))) static void
+integrateAvx2(Vec2 *positions, const Vec2 *velocities, size_t count) {
+  float *pos = &positions[0].x;
+  const float *vel = &velocities[0].x;
+  size_t floats = count * 2;
+  size_t i = 0;
+  for (; i + 8 <= floats; i += 8) {
+    _mm256_storeu_ps(pos + i, _mm256_add_ps(_mm256_loadu_ps(pos + i),
+                                            _mm256_loadu_ps(vel + i)));
+  }
+  integrateSse2(positions + i / 2, velocities + i / 2, count - i / 2);
+}
+
+__attribute__((target("avx2"))) static void
+bounceAvx2(Vec2 *positions, Vec2 *velocities, size_t count, const Vec2 &min,
+           const Vec2 &max) {
+  float *pos = &positions[0].x;
+  float *vel = &velocities[0].x;
+  size_t floats = count * 2;
+  const __m256 lower = _mm256_setr_ps(min.x, min.y, min.x, min.y, min.x,
+                                      min.y, min.x, min.y);
+  const __m256 upper = _mm256_setr_ps(max.x, max.y, max.x, max.y, max.x,
+                                      max.y, max.x, max.y);
+  const __m256 signBit = _mm256_set1_ps(-0.0f);
+  size_t i = 0;
+  for (; i + 8 <= floats; i += 8) {
+    __m256 p = _mm256_loadu_ps(pos + i);
+    __m256 v = _mm256_loadu_ps(vel + i);
+    __m256 below = _mm256_cmp_ps(p, lower, _CMP_LT_OQ);
+    __m256 above = _mm256_cmp_ps(p, upper, _CMP_GT_OQ);
+    __m256 speed = _mm256_andnot_ps(signBit, v);
+    v = _mm256_blendv_ps(v, speed, below);
+    v = _mm256_blendv_ps(v, _mm256_or_ps(speed, signBit), above);
+    _mm256_storeu_ps(pos + i, _mm256_min_ps(_mm256_max_ps(p, lower), upper));
+    _mm256_storeu_ps(vel + i, v);
+  }
+  bounceSse2(positions + i / 2, velocities + i / 2, count - i / 2, min, max);
+}
+
+__attribute__((target("avx2"))) static size_t
+overlapsAvx2(const Vec2 *positions, const float *radii, size_t count,
+             const Vec2 &probe, float probeRadius, uint32_t *hits) {
+  const float *pos = &positions[0].x;
+  const __m256 probeX = _mm256_set1_ps(probe.x);
+  const __m256 probeY = _mm256_set1_ps(probe.y);
+  const __m256 probeR = _mm256_set1_ps(probeRadius);
+  size_t hitCount = 0;
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    // the in-lane shuffle yields x0 x1 x4 x5 | x2 x3 x6 x7, swapping the
+    // middle 64-bit blocks restores entity order
+    __m256 a = _mm256_loadu_ps(pos + 2 * i);
+    __m256 b = _mm256_loadu_ps(pos + 2 * i + 8);
+    __m256 xs = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 ys = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    xs = _mm256_castpd_ps(
+        _mm256_permute4x64_pd(_mm256_castps_pd(xs), _MM_SHUFFLE(3, 1, 2, 0)));
+    ys = _mm256_castpd_ps(
+        _mm256_permute4x64_pd(_mm256_castps_pd(ys), _MM_SHUFFLE(3, 1, 2, 0)));
+    __m256 dx = _mm256_sub_ps(xs, probeX);
+    __m256 dy = _mm256_sub_ps(ys, probeY);
+    __m256 reach = _mm256_add_ps(_mm256_loadu_ps(radii + i), probeR);
+    __m256 distSquared =
+        _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(
+        distSquared, _mm256_mul_ps(reach, reach), _CMP_LT_OQ));
+    while (mask) {
+      int lane = __builtin_ctz(mask);
+      hits[hitCount++] = static_cast<uint32_t>(i + lane);
+      mask &= mask - 1;
+    }
+  }
+  size_t tail = overlapsSse2(positions + i, radii + i, count - i, probe,
+                             probeRadius, hits + hitCount);
+  for (size_t t = hitCount; t < hitCount + tail; ++t) {
+    hits[t] += static_cast<uint32_t>(i);
+  }
+  return hitCount + tail;
+}
+
+// x0 y0 .. x7 y7 in a and b -> x0..x7 in xs and y0..y7 in ys
+__attribute__((target("avx2"))) static inline void
+deinterleaveAvx2(__m256 a, __m256 b, __m256 &xs, __m256 &ys) {
+  xs = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+  ys = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+  xs = _mm256_castpd_ps(
+      _mm256_permute4x64_pd(_mm256_castps_pd(xs), _MM_SHUFFLE(3, 1, 2, 0)));
+  ys = _mm256_castpd_ps(
+      _mm256_permute4x64_pd(_mm256_castps_pd(ys), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__attribute__((target("avx2"))) static size_t
+sweepAvx2(const Vec2 *positions, const Vec2 *motions, const float *radii,
+          size_t count, const Vec2 &probe, const Vec2 &probeMotion,
+          float probeRadius, uint32_t *hits, float *times) {
+  const float *pos = &positions[0].x;
+  const float *mot = &motions[0].x;
+  const __m256 probeX = _mm256_set1_ps(probe.x);
+  const __m256 probeY = _mm256_set1_ps(probe.y);
+  const __m256 probeMotionX = _mm256_set1_ps(probeMotion.x);
+  const __m256 probeMotionY = _mm256_set1_ps(probeMotion.y);
+  const __m256 probeR = _mm256_set1_ps(probeRadius);
+  const __m256 zero = _mm256_setzero_ps();
+  size_t hitCount = 0;
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 px, py, mx, my;
+    deinterleaveAvx2(_mm256_loadu_ps(pos + 2 * i),
+                     _mm256_loadu_ps(pos + 2 * i + 8), px, py);
+    deinterleaveAvx2(_mm256_loadu_ps(mot + 2 * i),
+                     _mm256_loadu_ps(mot + 2 * i + 8), mx, my);
+    __m256 sx = _mm256_sub_ps(probeX, _mm256_sub_ps(px, mx));
+    __m256 sy = _mm256_sub_ps(probeY, _mm256_sub_ps(py, my));
+    __m256 dx = _mm256_sub_ps(probeMotionX, mx);
+    __m256 dy = _mm256_sub_ps(probeMotionY, my);
+    __m256 reach = _mm256_add_ps(_mm256_loadu_ps(radii + i), probeR);
+    __m256 a = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    __m256 b = _mm256_add_ps(_mm256_mul_ps(sx, dx), _mm256_mul_ps(sy, dy));
+    __m256 c = _mm256_sub_ps(
+        _mm256_add_ps(_mm256_mul_ps(sx, sx), _mm256_mul_ps(sy, sy)),
+        _mm256_mul_ps(reach, reach));
+    __m256 discriminant =
+        _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(a, c));
+    __m256 root =
+        _mm256_sub_ps(_mm256_sub_ps(zero, b),
+                      _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero)));
+    __m256 inside = _mm256_cmp_ps(c, zero, _CMP_LT_OQ);
+    __m256 crossing = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(b, zero, _CMP_LT_OQ),
+                      _mm256_cmp_ps(discriminant, zero, _CMP_GE_OQ)),
+        _mm256_cmp_ps(root, a, _CMP_LE_OQ));
+    int mask = _mm256_movemask_ps(_mm256_or_ps(inside, crossing));
+    if (mask == 0) {
+      continue;
+    }
+    alignas(32) float laneTimes[8];
+    _mm256_store_ps(laneTimes,
+                    _mm256_andnot_ps(inside, _mm256_div_ps(root, a)));
+    while (mask) {
+      int lane = __builtin_ctz(mask);
+      hits[hitCount] = static_cast<uint32_t>(i + lane);
+      times[hitCount++] = laneTimes[lane];
+      mask &= mask - 1;
+    }
+  }
+  size_t tail = sweepSse2(positions + i, motions + i, radii + i, count - i,
+                          probe, probeMotion, probeRadius, hits + hitCount,
+                          times + hitCount);
+  for (size_t t = hitCount; t < hitCount + tail; ++t) {
+    hits[t] += static_cast<uint32_t>(i);
+  }
+  return hitCount + tail;
+}
+
+#endif // SIMD_X86
+
+// ---------------------------------------------------------------- dispatch
+
+static Isa s_isa = detectIsa();
+
+Isa detectIsa() {
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::Avx2;
+  }
+  return Isa::Sse2;
+#else
+  return Isa::Scalar;
+#endif
+}
+
+Isa activeIsa() { return s_isa; }
+
+void useIsa(Isa isa) {
+  // never pick something wider than the CPU can run
+  s_isa = static_cast<int>(isa) <= static_cast<int>(detectIsa()) ? isa
+                                                                 : detectIsa();
+}
+
+const char *isaName(Isa isa) {
+  switch (isa) {
+  case Isa::Avx2:
+    return "avx2";
+  case Isa::Sse2:
+    return "sse2";
+  default:
+    return "scalar";
+  }
+}
+
+void integrate(Vec2 *positions, const Vec2 *velocities, size_t count) {
+  if (count == 0) {
+    return;
+  }
+#ifdef SIMD_X86
+  if (s_isa == Isa::Avx2) {
+    return integrateAvx2(positions, velocities, count);
+  }
+  if (s_isa == Isa::Sse2) {
+    return integrateSse2(positions, velocities, count);
+  }
+#endif
+  integrateScalar(positions, velocities, count);
+}
+
+void bounce(Vec2 *positions, Vec2 *velocities, size_t count, const Vec2 &min,
+            const Vec2 &max) {
+  if (count == 0) {
+    return;
+  }
+#ifdef SIMD_X86
+  if (s_isa == Isa::Avx2) {
+    return bounceAvx2(positions, velocities, count, min, max);
+  }
+  if (s_isa == Isa::Sse2) {
+    return bounceSse2(positions, velocities, count, min, max);
+  }
+#endif
+  bounceScalar(positions, velocities, count, min, max);
+}
+
+size_t overlaps(const Vec2 *positions, const float *radii, size_t count,
+                const Vec2 &probe, float probeRadius, uint32_t *hits) {
+  if (count == 0) {
+    return 0;
+  }
+#ifdef SIMD_X86
+  if (s_isa == Isa::Avx2) {
+    return overlapsAvx2(positions, radii, count, probe, probeRadius, hits);
+  }
+  if (s_isa == Isa::Sse2) {
+    return overlapsSse2(positions, radii, count, probe, probeRadius, hits);
+  }
+#endif
+  return overlapsScalar(positions, radii, count, probe, probeRadius, hits);
+}
+
+size_t sweep(const Vec2 *positions, const Vec2 *motions, const float *radii,
+             size_t count, const Vec2 &probe, const Vec2 &probeMotion,
+             float probeRadius, uint32_t *hits, float *times) {
+  if (count == 0) {
+    return 0;
+  }
+#ifdef SIMD_X86
+  if (s_isa == Isa::Avx2) {
+    return sweepAvx2(positions, motions, radii, count, probe, probeMotion,
+                     probeRadius, hits, times);
+  }
+  if (s_isa == Isa::Sse2) {
+    return sweepSse2(positions, motions, radii, count, probe, probeMotion,
+                     probeRadius, hits, times);
+  }
+#endif
+  return sweepScalar(positions, motions, radii, count, probe, probeMotion,
+                     probeRadius, hits, times);
+}
+
+} // namespace Simd
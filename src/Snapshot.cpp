@@ -0,0 +1,166 @@
+#include "../include/Snapshot.h"
+
+#include <algorithm>
+
+SnapshotWriter::SnapshotWriter(std::vector<char> &data) : m_data(data) {
+  m_data.clear();
+}
+
+void SnapshotWriter::writeBytes(const void *bytes, size_t size) {
+  size_t offset = m_data.size();
+  m_data.resize(offset + size);
+  if (size > 0) {
+    std::memcpy(m_data.data() + offset, bytes, size);
+  }
+}
+
+void SnapshotWriter::finish() {
+  m_data.resize((m_data.size() + 7) / 8 * 8, 0);
+}
+
+SnapshotReader::SnapshotReader(const char *data, size_t size)
+    : m_data(data), m_size(size) {}
+
+bool SnapshotReader::readBytes(void *bytes, size_t size) {
+  if (!m_ok || size > m_size - m_offset) {
+    m_ok = false;
+    return false;
+  }
+  if (size > 0) {
+    std::memcpy(bytes, m_data + m_offset, size);
+  }
+  m_offset += size;
+  return true;
+}
+
+bool SnapshotReader::ok() const { return m_ok; }
+
+namespace {
+
+uint64_t wordAt(const std::vector<uint64_t> &words, size_t i) {
+  return i < words.size() ? words[i] : 0;
+}
+
+// run length encodes older ^ newer as (zero words, literal words, literals)
+// groups, the zero words after the last literal are left out
+void encodeDelta(const std::vector<uint64_t> &older,
+                 const std::vector<uint64_t> &newer,
+                 std::vector<uint64_t> &delta) {
+  delta.clear();
+  size_t words = std::max(older.size(), newer.size());
+  size_t i = 0;
+  while (i < words) {
+    size_t zeroStart = i;
+    while (i < words && wordAt(older, i) == wordAt(newer, i)) {
+      i++;
+    }
+    if (i == words) {
+      break;
+    }
+    size_t header = delta.size();
+    delta.push_back(i - zeroStart);
+    delta.push_back(0);
+    // a literal run ends at the first pair of equal words, a single equal
+    // word costs less as a literal than as a new group
+    while (i < words) {
+      uint64_t x = wordAt(older, i) ^ wordAt(newer, i);
+      if (x == 0 && (i + 1 == words ||
+                     wordAt(older, i + 1) == wordAt(newer, i + 1))) {
+        break;
+      }
+      delta.push_back(x);
+      i++;
+    }
+    delta[header + 1] = delta.size() - header - 2;
+  }
+}
+
+// older = newer ^ delta, cut to olderWords
+void applyDelta(const std::vector<uint64_t> &newer,
+                const std::vector<uint64_t> &delta, size_t olderWords,
+                std::vector<uint64_t> &older) {
+  older.assign(newer.begin(),
+               newer.begin() + std::min(newer.size(), olderWords));
+  older.resize(std::max(newer.size(), olderWords), 0);
+  size_t position = 0;
+  size_t i = 0;
+  while (i < delta.size()) {
+    position += delta[i];
+    size_t literals = delta[i + 1];
+    i += 2;
+    for (size_t end = i + literals; i < end; ++i) {
+      older[position++] ^= delta[i];
+    }
+  }
+  older.resize(olderWords);
+}
+
+} // namespace
+
+void RewindBuffer::reset(size_t capacity) {
+  m_frames.assign(capacity, Frame());
+  m_first = 0;
+  m_count = 0;
+  m_latest.clear();
+  m_deltaWords = 0;
+}
+
+size_t RewindBuffer::capacity() const { return m_frames.size(); }
+
+size_t RewindBuffer::size() const { return m_count; }
+
+size_t RewindBuffer::bytes() const {
+  return (m_deltaWords + m_latest.size()) * sizeof(uint64_t);
+}
+
+void RewindBuffer::push(int frame, const std::vector<char> &snapshot) {
+  if (m_frames.empty()) {
+    return;
+  }
+  if (m_count == m_frames.size()) {
+    // drop the oldest frame, the delta of the next one leads to it and is
+    // not needed either
+    m_deltaWords -= m_frames[m_first].delta.size();
+    m_frames[m_first].delta.clear();
+    m_first = (m_first + 1) % m_frames.size();
+    m_count--;
+    m_deltaWords -= m_frames[m_first].delta.size();
+    m_frames[m_first].delta.clear();
+  }
+  Frame &entry = m_frames[(m_first + m_count) % m_frames.size()];
+
+  m_scratch.resize(snapshot.size() / sizeof(uint64_t));
+  std::memcpy(m_scratch.data(), snapshot.data(),
+              m_scratch.size() * sizeof(uint64_t));
+  entry.frame = frame;
+  entry.previousWords = m_latest.size();
+  if (m_count > 0) {
+    encodeDelta(m_latest, m_scratch, entry.delta);
+  } else {
+    entry.delta.clear();
+  }
+  m_deltaWords += entry.delta.size();
+  m_latest.swap(m_scratch);
+  m_count++;
+}
+
+bool RewindBuffer::pop(int &frame, std::vector<char> &snapshot) {
+  if (m_count == 0) {
+    return false;
+  }
+  Frame &entry = m_frames[(m_first + m_count - 1) % m_frames.size()];
+  frame = entry.frame;
+  snapshot.resize(m_latest.size() * sizeof(uint64_t));
+  std::memcpy(snapshot.data(), m_latest.data(), snapshot.size());
+
+  m_count--;
+  m_deltaWords -= entry.delta.size();
+  if (m_count > 0) {
+    applyDelta(m_latest, entry.delta, entry.previousWords, m_scratch);
+    m_latest.swap(m_scratch);
+  } else {
+    m_latest.clear();
+  }
+  entry.delta.clear();
+  return true;
+}
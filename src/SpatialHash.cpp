@@ -0,0 +1,110 @@
+#include "../include/SpatialHash.h"
+
+#include <algorithm>
+#include <cmath>
+
+void SpatialHash::reset(const Vec2 &worldSize, float cellSize) {
+  m_cellSize = std::max(cellSize, 1.0f);
+  m_inverseCellSize = 1.0f / m_cellSize;
+  m_columns = std::max(1, static_cast<int>(std::ceil(worldSize.x / m_cellSize)));
+  m_rows = std::max(1, static_cast<int>(std::ceil(worldSize.y / m_cellSize)));
+  m_cellStart.assign(static_cast<size_t>(m_columns) * m_rows + 1, 0);
+  clear();
+}
+
+void SpatialHash::clear() {
+  m_pending.clear();
+  m_items.clear();
+  m_maxRadius = 0;
+  m_maxMotion = 0;
+}
+
+void SpatialHash::insert(Entity *entity, const Vec2 &pos, float radius,
+                         int group, const Vec2 &motion) {
+  Item item;
+  item.entity = entity;
+  item.pos = pos;
+  item.radius = radius;
+  item.group = group;
+  item.motion = motion;
+  m_pending.push_back(item);
+  m_maxRadius = std::max(m_maxRadius, radius);
+  m_maxMotion = std::max(
+      m_maxMotion, std::max(std::fabs(motion.x), std::fabs(motion.y)));
+}
+
+void SpatialHash::build() {
+  // counting sort of the pending items by cell
+  std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+  m_cellIndex.resize(m_pending.size());
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    uint32_t cell = static_cast<uint32_t>(cellY(m_pending[i].pos.y)) * m_columns +
+                    cellX(m_pending[i].pos.x);
+    m_cellIndex[i] = cell;
+    m_cellStart[cell + 1]++;
+  }
+  for (size_t cell = 1; cell < m_cellStart.size(); ++cell) {
+    m_cellStart[cell] += m_cellStart[cell - 1];
+  }
+
+  // scatter, using the start of the next cell as a running insert cursor
+  m_items.resize(m_pending.size());
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    m_items[m_cellStart[m_cellIndex[i]]++] = m_pending[i];
+  }
+  // the cursors now hold the end of every cell, shift them back to starts
+  for (size_t cell = m_cellStart.size() - 1; cell > 0; --cell) {
+    m_cellStart[cell] = m_cellStart[cell - 1];
+  }
+  m_cellStart[0] = 0;
+  m_pending.clear();
+
+  m_positions.resize(m_items.size());
+  m_radii.resize(m_items.size());
+  m_motions.resize(m_items.size());
+  for (Scratch &scratch : m_scratch) {
+    scratch.hits.resize(m_items.size());
+    scratch.times.resize(m_items.size());
+  }
+  for (size_t i = 0; i < m_items.size(); ++i) {
+    m_positions[i] = m_items[i].pos;
+    m_radii[i] = m_items[i].radius;
+    m_motions[i] = m_items[i].motion;
+  }
+}
+
+// clamped before the conversion, a position far outside the world (or NaN)
+// does not fit an int
+static int clampCell(float cell, int cells) {
+  if (!(cell > 0)) {
+    return 0;
+  }
+  return cell < cells - 1 ? static_cast<int>(cell) : cells - 1;
+}
+
+int SpatialHash::cellX(float x) const {
+  return clampCell(std::floor(x * m_inverseCellSize), m_columns);
+}
+
+int SpatialHash::cellY(float y) const {
+  return clampCell(std::floor(y * m_inverseCellSize), m_rows);
+}
+
+void SpatialHash::reserve(size_t items) {
+  m_pending.reserve(items);
+  m_items.reserve(items);
+  m_cellIndex.reserve(items);
+  m_positions.reserve(items);
+  m_radii.reserve(items);
+  m_motions.reserve(items);
+  m_reserved = items;
+  for (Scratch &scratch : m_scratch) {
+    scratch.hits.reserve(items);
+    scratch.times.reserve(items);
+  }
+}
+
+void SpatialHash::setThreadCount(size_t count) {
+  m_scratch.resize(std::max<size_t>(count, 1));
+  reserve(m_reserved);
+}
@@ -0,0 +1,25 @@
+#include "../include/Tags.h"
+
+TagRegistry::TagRegistry() {
+  // must match the constants in the Tag namespace
+  intern("default");
+  intern("player");
+  intern("enemy");
+  intern("smallEnemy");
+  intern("bullet");
+}
+
+TagId TagRegistry::intern(const std::string &name) {
+  auto found = m_ids.find(name);
+  if (found != m_ids.end()) {
+    return found->second;
+  }
+  TagId id = static_cast<TagId>(m_names.size());
+  m_names.push_back(name);
+  m_ids.emplace(name, id);
+  return id;
+}
+
+const std::string &TagRegistry::name(TagId id) const { return m_names[id]; }
+
+size_t TagRegistry::size() const { return m_names.size(); }
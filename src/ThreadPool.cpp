@@ -0,0 +1,161 @@
+#include "../include/ThreadPool.h"
+
+#include <algorithm>
+
+static uint64_t packRange(uint32_t begin, uint32_t end) {
+  return (static_cast<uint64_t>(begin) << 32) | end;
+}
+
+static uint32_t rangeBegin(uint64_t range) {
+  return static_cast<uint32_t>(range >> 32);
+}
+
+static uint32_t rangeEnd(uint64_t range) {
+  return static_cast<uint32_t>(range);
+}
+
+static thread_local size_t t_threadIndex = 0;
+
+ThreadPool::ThreadPool() {}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+void ThreadPool::start(size_t threads, size_t minChunkSize) {
+  stop();
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  m_minChunkSize = std::max<size_t>(1, minChunkSize);
+  m_queues.reset(new Queue[threads]);
+  m_stopping = false;
+  for (size_t i = 1; i < threads; ++i) {
+    m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+}
+
+size_t ThreadPool::threadCount() const { return m_workers.size() + 1; }
+
+size_t ThreadPool::threadIndex() { return t_threadIndex; }
+
+void ThreadPool::workerLoop(size_t queue) {
+  t_threadIndex = queue;
+  uint64_t seenEpoch = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&] {
+        return m_stopping || (m_jobOpen && m_epoch != seenEpoch);
+      });
+      if (m_stopping) {
+        return;
+      }
+      seenEpoch = m_epoch;
+      // joining under the lock, so run() cannot close the job in between
+      m_activeWorkers++;
+    }
+    work(queue);
+    m_activeWorkers--;
+  }
+}
+
+void ThreadPool::run(size_t count, void (*call)(void *, size_t, size_t),
+                     void *context) {
+  size_t participants = threadCount();
+  // a few chunks per participant leave room for stealing uneven work
+  size_t chunkSize = std::max(m_minChunkSize,
+                              (count + participants * 4 - 1) /
+                                  (participants * 4));
+  size_t chunks = (count + chunkSize - 1) / chunkSize;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_call = call;
+    m_context = context;
+    m_count = count;
+    m_chunkSize = chunkSize;
+    m_remainingChunks = chunks;
+    // deal out contiguous chunk ranges, one per participant
+    for (size_t i = 0; i < participants; ++i) {
+      uint32_t begin = static_cast<uint32_t>(chunks * i / participants);
+      uint32_t end = static_cast<uint32_t>(chunks * (i + 1) / participants);
+      m_queues[i].range.store(packRange(begin, end));
+    }
+    m_epoch++;
+    m_jobOpen = true;
+  }
+  m_wake.notify_all();
+
+  work(0);
+  while (m_remainingChunks.load() > 0) {
+    std::this_thread::yield();
+  }
+
+  // stop late workers from joining, then wait for the ones still inside
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobOpen = false;
+  }
+  while (m_activeWorkers.load() > 0) {
+    std::this_thread::yield();
+  }
+}
+
+void ThreadPool::work(size_t queue) {
+  while (true) {
+    uint32_t chunk;
+    while (popChunk(queue, chunk)) {
+      size_t begin = chunk * m_chunkSize;
+      size_t end = std::min(m_count, begin + m_chunkSize);
+      m_call(m_context, begin, end);
+      m_remainingChunks--;
+    }
+    if (!stealChunks(queue)) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::popChunk(size_t queue, uint32_t &chunk) {
+  std::atomic<uint64_t> &range = m_queues[queue].range;
+  uint64_t current = range.load();
+  while (rangeBegin(current) < rangeEnd(current)) {
+    uint64_t next = packRange(rangeBegin(current) + 1, rangeEnd(current));
+    if (range.compare_exchange_weak(current, next)) {
+      chunk = rangeBegin(current);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::stealChunks(size_t queue) {
+  size_t participants = threadCount();
+  for (size_t offset = 1; offset < participants; ++offset) {
+    std::atomic<uint64_t> &victim =
+        m_queues[(queue + offset) % participants].range;
+    uint64_t current = victim.load();
+    while (rangeBegin(current) < rangeEnd(current)) {
+      uint32_t begin = rangeBegin(current);
+      uint32_t end = rangeEnd(current);
+      uint32_t split = end - (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(current, packRange(begin, split))) {
+        // our own range is empty, so no thief races with this store
+        m_queues[queue].range.store(packRange(split, end));
+        return true;
+      }
+    }
+  }
+  return false;
+}
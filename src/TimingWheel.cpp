@@ -0,0 +1,77 @@
+#include "../include/TimingWheel.h"
+
+#include <algorithm>
+
+TimingWheel::TimingWheel() { clear(0); }
+
+void TimingWheel::reserve(size_t entries) { m_nodes.reserve(entries); }
+
+void TimingWheel::clear(uint32_t now) {
+  std::fill(&m_slots[0][0], &m_slots[0][0] + levels * (slotMask + 1), npos);
+  m_nodes.clear();
+  m_free = npos;
+  m_now = now;
+  m_size = 0;
+}
+
+uint32_t TimingWheel::now() const { return m_now; }
+
+size_t TimingWheel::size() const { return m_size; }
+
+void TimingWheel::insert(uint32_t node) {
+  uint32_t tick = m_nodes[node].tick;
+  int level = 0;
+  while (level < levels - 1 &&
+         (tick >> ((level + 1) * slotBits)) !=
+             (m_now >> ((level + 1) * slotBits))) {
+    level++;
+  }
+  uint32_t &head = m_slots[level][(tick >> (level * slotBits)) & slotMask];
+  m_nodes[node].next = head;
+  head = node;
+}
+
+void TimingWheel::schedule(EntityHandle handle, uint32_t tick) {
+  uint32_t node = m_free;
+  if (node != npos) {
+    m_free = m_nodes[node].next;
+  } else {
+    node = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node());
+  }
+  m_nodes[node].handle = handle;
+  m_nodes[node].tick = std::max(tick, m_now + 1);
+  insert(node);
+  m_size++;
+}
+
+void TimingWheel::advance(std::vector<EntityHandle> &due) {
+  m_now++;
+  // the slots of the higher levels that start at this tick move down, from
+  // the top so an entry can fall through several levels at once
+  for (int level = levels - 1; level > 0; --level) {
+    if ((m_now & ((1u << (level * slotBits)) - 1)) != 0) {
+      continue;
+    }
+    uint32_t &head = m_slots[level][(m_now >> (level * slotBits)) & slotMask];
+    uint32_t node = head;
+    head = npos;
+    while (node != npos) {
+      uint32_t next = m_nodes[node].next;
+      insert(node);
+      node = next;
+    }
+  }
+
+  uint32_t &head = m_slots[0][m_now & slotMask];
+  uint32_t node = head;
+  head = npos;
+  while (node != npos) {
+    uint32_t next = m_nodes[node].next;
+    due.push_back(m_nodes[node].handle);
+    m_nodes[node].next = m_free;
+    m_free = node;
+    m_size--;
+    node = next;
+  }
+}
@@ -1,8 +1,100 @@
 #include <SFML/Graphics.hpp>
 #include "../include/Game.h"
 
-int main()
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[])
 {
-  Game g("../src/config.txt");
+  std::string configPath = "../src/config.txt";
+  int headlessFrames = 0;
+  int seed = -1;
+  std::string tracePath;
+  int autofire = 0;
+  int allocationWarmup = -1;
+  std::string compiledPath;
+  std::string loadPath;
+  std::string savePath;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--config" && i + 1 < argc) {
+      configPath = argv[++i];
+    } else if (arg == "--headless" && i + 1 < argc) {
+      headlessFrames = std::stoi(argv[++i]);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = std::stoi(argv[++i]);
+    } else if (arg == "--trace" && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (arg == "--autofire" && i + 1 < argc) {
+      autofire = std::stoi(argv[++i]);
+    } else if (arg == "--check-alloc" && i + 1 < argc) {
+      allocationWarmup = std::stoi(argv[++i]);
+    } else if (arg == "--compile-config" && i + 1 < argc) {
+      compiledPath = argv[++i];
+    } else if (arg == "--load-snapshot" && i + 1 < argc) {
+      loadPath = argv[++i];
+    } else if (arg == "--save-snapshot" && i + 1 < argc) {
+      savePath = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--config PATH] [--headless FRAMES] [--seed N]"
+                << " [--trace PATH] [--autofire FRAMES]"
+                << " [--check-alloc WARMUP_FRAMES]"
+                << " [--compile-config OUT]"
+                << " [--load-snapshot PATH] [--save-snapshot PATH]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  // validate the config and write it in the compiled format, which loads
+  // without parsing
+  if (!compiledPath.empty()) {
+    GameConfig config;
+    ConfigError error;
+    if (!loadConfig(configPath, config, error) ||
+        !compileConfig(config, compiledPath, error)) {
+      std::cerr << "Invalid config: " << error.str() << std::endl;
+      return 1;
+    }
+    std::cout << "Compiled " << configPath << " to " << compiledPath
+              << std::endl;
+    return 0;
+  }
+
+  if (headlessFrames > 0) {
+    Game g(configPath, true);
+    if (seed >= 0) {
+      g.setSeed(seed);
+    }
+    if (!tracePath.empty()) {
+      g.enableTrace(tracePath);
+    }
+    g.setAutofire(autofire);
+    if (allocationWarmup >= 0) {
+      g.checkAllocations(allocationWarmup);
+    }
+    if (!loadPath.empty() && !g.loadSnapshot(loadPath)) {
+      return 1;
+    }
+    int status = g.runHeadless(headlessFrames);
+    // a long session can be continued later with --load-snapshot
+    if (!savePath.empty() && !g.saveSnapshot(savePath)) {
+      return 1;
+    }
+    return status;
+  }
+
+  Game g(configPath);
+  if (seed >= 0) {
+    g.setSeed(seed);
+  }
+  if (!tracePath.empty()) {
+    g.enableTrace(tracePath);
+  }
+  if (!loadPath.empty() && !g.loadSnapshot(loadPath)) {
+    return 1;
+  }
   g.run();
 }